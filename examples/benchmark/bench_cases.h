@@ -0,0 +1,274 @@
+/**
+ * @file bench_cases.h
+ * @brief Benchmark cases shared by the benchmark sketch and the host benchmark.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ *
+ * The runner supplies a Timer with:
+ *   void start();
+ *   void stop(Name name, bbsc_index_t size, uint16_t iterations);
+ * and defines BENCH_NAME(s) before including this file (F(s) on a board so
+ * the names stay in flash, plain s on the host).
+ */
+
+#ifndef BBSC_BENCH_CASES_H
+#define BBSC_BENCH_CASES_H
+
+#include "bit_based_state_control.h"
+#include "bit_based_state_preset.h"
+
+#ifndef BENCH_NAME
+#define BENCH_NAME(s) (s)
+#endif
+
+// Sink that keeps the compiler from dropping benchmarked calls
+static volatile uint32_t benchSink;
+
+// Times `iterations` runs of one statement; `n` is the iteration number
+#define BENCH_CASE(name, ...)                            \
+    do {                                                 \
+        timer.start();                                   \
+        for (uint16_t n = 0; n < iterations; n++) {      \
+            __VA_ARGS__;                                 \
+        }                                                \
+        timer.stop(BENCH_NAME(name), size, iterations);  \
+    } while (0)
+
+// forEachTrue() callback
+static void benchVisit(bbsc_index_t index, void*) {
+    benchSink += index;
+}
+
+// Observer callback
+static void benchObserve(bbsc_sindex_t index, void*) {
+    benchSink += (uint32_t)index;
+}
+
+// Flash mask with the first, middle and last states set
+template <bbsc_index_t Size>
+static const uint8_t* benchMaskFor() {
+    return BBSC_MASK(Size, 0, Size / 2, Size - 1);
+}
+
+// Flash mask for one of the benchmarked sizes (nullptr for other sizes)
+static const uint8_t* benchMask(bbsc_index_t size) {
+    switch (size) {
+        case 8: return benchMaskFor<8>();
+        case 16: return benchMaskFor<16>();
+        case 32: return benchMaskFor<32>();
+        case 64: return benchMaskFor<64>();
+        case 128: return benchMaskFor<128>();
+        case 254: return benchMaskFor<254>();
+#if BBSC_MAX_STATES >= 4096
+        case 1024: return benchMaskFor<1024>();
+        case 4096: return benchMaskFor<4096>();
+#endif
+        default: return nullptr;
+    }
+}
+
+/**
+ * @brief Runs every case for one set size.
+ * @tparam Timer Runner-specific timer (see the file comment).
+ * @param timer Timer reporting each case.
+ * @param size Number of states.
+ * @param iterations Runs per case.
+ */
+template <class Timer>
+void runBenchCases(Timer& timer, bbsc_index_t size, uint16_t iterations) {
+    BBStateControl s(size);
+    BBStateControl other(size);
+    size_t textSize = s.serializeStatesSize();
+    size_t binSize = s.serializeBinarySize();
+    size_t hexSize = s.serializeHexSize();
+    char* text = new char[textSize > hexSize ? textSize : hexSize];
+    uint8_t* bin = new uint8_t[binSize + 16];
+    if (!text || !bin) {
+        delete[] text;
+        delete[] bin;
+        return;
+    }
+    bbsc_index_t last = size - 1;
+    bbsc_index_t quarter = size / 4;
+
+    // Construction
+    BENCH_CASE("BBStateControl(size) + destructor", {
+        BBStateControl t(size);
+        benchSink += t.byteSize();
+    });
+
+    // Single-state updates
+    BENCH_CASE("setState(i) exclusive", s.setState(n % size));
+    s.resetArray();
+    BENCH_CASE("setState(i, true, false)", s.setState(n % size, true, false));
+    BENCH_CASE("setState(i, false, false)", s.setState(n % size, false, false));
+    BENCH_CASE("toggleState(i)", s.toggleState(n % size));
+    s.setAllStates(true);
+    BENCH_CASE("clear trueIndex + getTrueIndex", {
+        s.setState(n % size, false, false);
+        benchSink += s.getTrueIndex();
+        s.setState(n % size, true, false);
+    });
+    BENCH_CASE("getState(i)", benchSink += s.getState(n % size));
+    BENCH_CASE("getIndex()", s.getIndex(text, 8));
+    s.setObserver(benchObserve);
+    BENCH_CASE("setState(i) exclusive, observer", s.setState(n % size));
+    s.setObserver(nullptr);
+    BENCH_CASE("beginBatch() + 8 setState(i) + commit()", {
+        s.beginBatch();
+        for (uint8_t k = 0; k < 8; k++) s.setState((n + k) % size, true, k == 0);
+        s.commit();
+    });
+
+    // Whole-set queries, worst case: only the last state set
+    s.resetArray();
+    s.setState(last, true, false);
+    BENCH_CASE("getTrueIndex()", benchSink += s.getTrueIndex());
+    BENCH_CASE("getFirstTrueIndex()", benchSink += s.getFirstTrueIndex());
+    BENCH_CASE("countTrueStates()", benchSink += s.countTrueStates());
+    BENCH_CASE("isAssignedIndex()", benchSink += s.isAssignedIndex());
+    BENCH_CASE("validateSingleState()", benchSink += s.validateSingleState());
+    BENCH_CASE("findState(true)", benchSink += s.findState(true));
+    BENCH_CASE("findState(true, q)", benchSink += s.findState(true, quarter));
+    BENCH_CASE("nextTrue(0)", benchSink += s.nextTrue(0));
+    BENCH_CASE("prevTrue(last)", benchSink += s.prevTrue(last));
+    BENCH_CASE("nextTrueCyclic(last)", benchSink += s.nextTrueCyclic(last));
+    BENCH_CASE("testRangeAny(0, last - 1)", benchSink += s.testRangeAny(0, last - 1));
+    if (s.enableSummary()) {
+        BENCH_CASE("getFirstTrueIndex() (summary)", benchSink += s.getFirstTrueIndex());
+        BENCH_CASE("nextTrue(0) (summary)", benchSink += s.nextTrue(0));
+        BENCH_CASE("setState(i, true, false) (summary)", s.setState(n % last, n & 1, false));
+        s.disableSummary();
+    }
+    s.setAllStates(true);
+    s.setState(last, false, false);
+    BENCH_CASE("nextFalse(-1)", benchSink += s.nextFalse(-1));
+    BENCH_CASE("testRangeAll(0, last - 1)", benchSink += s.testRangeAll(0, last - 1));
+
+    // Half the states set, every other index
+    s.resetArray();
+    for (bbsc_index_t i = 0; i < size; i += 2) s.setState(i, true, false);
+    BENCH_CASE("for (i : trueIndices())", {
+        for (bbsc_index_t i : s.trueIndices()) benchSink += i;
+    });
+    BENCH_CASE("getAllTrueIndices(out, 8)", {
+        bbsc_index_t out[8];
+        benchSink += s.getAllTrueIndices(out, 8);
+    });
+    BENCH_CASE("getAllTrueIndices(count) + delete[]", {
+        bbsc_index_t count;
+        bbsc_index_t* all = s.getAllTrueIndices(count);
+        benchSink += count;
+        delete[] all;
+    });
+    BENCH_CASE("forEachTrue()", s.forEachTrue(benchVisit));
+    BENCH_CASE("rank(i) (no table)", benchSink += s.rank(n % size));
+    BENCH_CASE("select(k) (no table)", benchSink += s.select(n % (size / 2 + 1)));
+    if (s.enableRankIndex()) {
+        BENCH_CASE("rank(i) (table)", benchSink += s.rank(n % size));
+        BENCH_CASE("select(k) (table)", benchSink += s.select(n % (size / 2 + 1)));
+        s.disableRankIndex();
+    }
+
+    // Whole-set writes
+    BENCH_CASE("setState(i) exclusive, all set", {
+        s.setState(n % size);
+        s.setRange(0, last, true);
+    });
+    BENCH_CASE("setAllStates(true)", s.setAllStates(true));
+    BENCH_CASE("resetArray()", s.resetArray());
+    BENCH_CASE("setDefaultIndex()", s.setDefaultIndex());
+    BENCH_CASE("invertStates()", s.invertStates());
+    BENCH_CASE("setRangeStates(q, 3q)", s.setRangeStates(quarter, 3 * quarter, true));
+    BENCH_CASE("setRange(q, 3q)", s.setRange(quarter, 3 * quarter, true));
+    BENCH_CASE("toggleRange(q, 3q)", s.toggleRange(quarter, 3 * quarter));
+    BENCH_CASE("clearRange(q, 3q)", s.clearRange(quarter, 3 * quarter));
+    BENCH_CASE("countRange(q, 3q)", benchSink += s.countRange(quarter, 3 * quarter));
+
+    // Exclusive groups: the first quarter is one group
+    BENCH_CASE("defineGroup() + clearGroups()", {
+        benchSink += s.defineGroup(0, quarter);
+        s.clearGroups();
+    });
+    s.defineGroup(0, quarter);
+    s.setAllStates(true);
+    BENCH_CASE("setState(i) exclusive, grouped", s.setState(n % (quarter + 1)));
+    BENCH_CASE("groupOf(i)", benchSink += s.groupOf(n % size));
+    BENCH_CASE("getGroupActive(0)", benchSink += s.getGroupActive(0));
+    BENCH_CASE("clearGroup(0)", s.clearGroup(0));
+    s.clearGroups();
+
+    // Flash presets
+    const uint8_t* mask = benchMask(size);
+    if (mask) {
+        BENCH_CASE("loadPreset()", benchSink += s.loadPreset(mask));
+        BENCH_CASE("matchesPreset()", benchSink += s.matchesPreset(mask));
+    }
+
+    // Raw bytes and dirty tracking
+    BENCH_CASE("copyBytes() msb first", benchSink += s.copyBytes(bin, binSize, true));
+    BENCH_CASE("dataChanged()", s.dataChanged());
+    if (s.enableDirtyTracking()) {
+        BENCH_CASE("setState(i) + consumeDirty(out, 8)", {
+            bbsc_index_t out[8];
+            s.setState(n % size);
+            benchSink += s.consumeDirty(out, 8);
+        });
+        BENCH_CASE("isDirty()", benchSink += s.isDirty());
+        s.disableDirtyTracking();
+    }
+
+    // Set operations
+    other.setRange(0, quarter, true);
+    BENCH_CASE("copyStatesFrom()", s.copyStatesFrom(other));
+    BENCH_CASE("orWith()", s.orWith(other));
+    BENCH_CASE("andWith()", s.andWith(other));
+    BENCH_CASE("xorWith()", s.xorWith(other));
+    BENCH_CASE("andNotWith()", s.andNotWith(other));
+    BENCH_CASE("equals()", benchSink += s.equals(other));
+    BENCH_CASE("intersects()", benchSink += s.intersects(other));
+    BENCH_CASE("isSubsetOf()", benchSink += s.isSubsetOf(other));
+    BENCH_CASE("swap()", benchSink += s.swap(other));
+
+    // Snapshots and serialization
+    BENCH_CASE("saveState()", s.saveState());
+    BENCH_CASE("restoreSavedState()", s.restoreSavedState());
+    BENCH_CASE("swapWithSaved()", s.swapWithSaved());
+
+    // Edge views: states 0 to q set since the saved state, the next quarter cleared
+    s.resetArray();
+    s.setRange(quarter, 2 * quarter, true);
+    s.saveState();
+    s.setRange(0, quarter, true);
+    s.clearRange(quarter + 1, 2 * quarter);
+    BENCH_CASE("hasChanges()", benchSink += s.hasChanges());
+    BENCH_CASE("for (i : rising())", {
+        for (bbsc_index_t i : s.rising()) benchSink += i;
+    });
+    BENCH_CASE("for (i : falling())", {
+        for (bbsc_index_t i : s.falling()) benchSink += i;
+    });
+    BENCH_CASE("for (i : changed())", {
+        for (bbsc_index_t i : s.changed()) benchSink += i;
+    });
+    BENCH_CASE("serializeStates()", s.serializeStates(text, textSize));
+    BENCH_CASE("serializeHex()", s.serializeHex(text, hexSize));
+    BENCH_CASE("serializeBinary()", benchSink += s.serializeBinary(bin, binSize));
+    BENCH_CASE("deserializeBinary()", benchSink += s.deserializeBinary(bin, binSize));
+    s.saveState();
+    s.toggleState(last);
+    BENCH_CASE("crc8(binary)", benchSink += BBStateControl::crc8(bin, binSize));
+    BENCH_CASE("encodeDelta() one change", benchSink += s.encodeDelta(bin, binSize + 16));
+    size_t deltaSize = s.encodeDelta(bin, binSize + 16);
+    BENCH_CASE("applyDelta() one change", benchSink += s.applyDelta(bin, deltaSize)); // Toggles back and forth
+    BENCH_CASE("encodeDelta(other) quarter", benchSink += s.encodeDelta(other, bin, binSize + 16));
+    deltaSize = s.encodeDelta(other, bin, binSize + 16);
+    BENCH_CASE("applyDelta() quarter", benchSink += s.applyDelta(bin, deltaSize));
+
+    delete[] text;
+    delete[] bin;
+}
+
+#endif  // BBSC_BENCH_CASES_H
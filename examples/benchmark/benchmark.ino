@@ -0,0 +1,70 @@
+// Times every BBStateControl case of bench_cases.h on the board and prints
+// cycles per operation for each set size. The same cases run on a desktop
+// with extras/benchmark/host_benchmark.cpp (ns/op). Code size is the
+// "Sketch uses ... bytes" line of the build; per-function sizes come from the
+// code_size target of extras/benchmark/CMakeLists.txt.
+
+#include "bit_based_state_control.h"
+
+#define BENCH_NAME(s) F(s)
+
+#if defined(ESP32) || defined(ESP8266)
+// Xtensa/RISC-V core cycle counter
+static inline uint32_t cycles() { return ESP.getCycleCount(); }
+static void startCycles() {}
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+// Cortex-M3/M4/M7 DWT cycle counter
+static inline uint32_t cycles() { return *(volatile uint32_t*)0xE0001004; }     // DWT_CYCCNT
+static void startCycles() {
+    *(volatile uint32_t*)0xE000EDFC |= (1UL << 24);  // DEMCR.TRCENA
+    *(volatile uint32_t*)0xE0001004 = 0;
+    *(volatile uint32_t*)0xE0001000 |= 1;            // DWT_CTRL.CYCCNTENA
+}
+#else
+// No cycle counter (AVR, Cortex-M0+): derive cycles from micros()
+static inline uint32_t cycles() { return micros() * clockCyclesPerMicrosecond(); }
+static void startCycles() {}
+#endif
+
+/**
+ * Prints each case as one line of "size  cycles/op  name".
+ */
+class BoardTimer {
+public:
+    void start() { begin = cycles(); }
+
+    template <class Name>
+    void stop(Name name, bbsc_index_t size, uint16_t iterations) {
+        uint32_t elapsed = cycles() - begin;
+        Serial.print(size);
+        Serial.print('\t');
+        Serial.print(elapsed / iterations);
+        Serial.print('\t');
+        Serial.println(name);
+    }
+
+private:
+    uint32_t begin;
+};
+
+#include "bench_cases.h"
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+        ;
+    }
+    startCycles();
+    Serial.println(F("size\tcycles/op\tcase"));
+    static const uint16_t SIZES[] = {8, 16, 32, 64, 128, 254, 1024, 4096};
+    BoardTimer timer;
+    for (uint8_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        if (SIZES[i] > BBSC_MAX_STATES) break;
+        runBenchCases(timer, (bbsc_index_t)SIZES[i], 200);
+    }
+    Serial.print(F("checksum "));
+    Serial.println(benchSink);
+}
+
+void loop() {
+}
@@ -35,17 +35,23 @@ void setup() {
     printStates();
 
     Serial.println(F("Get all true indices"));
-    uint8_t count;
-    uint8_t* trueIndices = states.getAllTrueIndices(count);
+    bbsc_index_t trueIndices[10];
+    bbsc_index_t count = states.getAllTrueIndices(trueIndices, sizeof(trueIndices) / sizeof(trueIndices[0]));
     Serial.print(F("True indices (count="));
     Serial.print(count);
     Serial.print(F("): "));
-    for (uint8_t i = 0; i < count; i++) {
+    for (bbsc_index_t i = 0; i < count; i++) {
         Serial.print(trueIndices[i]);
         Serial.print(F(" "));
     }
     Serial.println();
-    delete[] trueIndices; // Free allocated memory
+
+    Serial.println(F("Iterate true indices"));
+    for (bbsc_index_t index : states.trueIndices()) {
+        Serial.print(index);
+        Serial.print(F(" "));
+    }
+    Serial.println();
 }
 
 void loop() {
@@ -0,0 +1,38 @@
+# Reports the bytes of code of every function in the library object files,
+# largest first per file, using nm -C -S --size-sort. Run by the code_size
+# target of CMakeLists.txt:
+#
+#   cmake -DNM=nm -DOBJECTS=<objects> -DREPORT=code_size.txt -P code_size.cmake
+
+set(report "")
+set(total 0)
+foreach(object IN LISTS OBJECTS)
+    execute_process(COMMAND ${NM} -C -S --size-sort ${object}
+                    OUTPUT_VARIABLE symbols RESULT_VARIABLE failed)
+    if(failed)
+        message(FATAL_ERROR "${NM} failed on ${object}")
+    endif()
+    get_filename_component(name ${object} NAME)
+    set(lines "")
+    set(file_total 0)
+    string(REGEX MATCHALL "[^\n]+" entries "${symbols}")
+    list(REMOVE_DUPLICATES entries) # Complete and base constructors/destructors share one body
+    foreach(entry IN LISTS entries)
+        if(entry MATCHES "^[0-9a-fA-F]+ ([0-9a-fA-F]+) [tTwW] (.+)$")
+            math(EXPR bytes "0x${CMAKE_MATCH_1}")
+            math(EXPR file_total "${file_total} + ${bytes}")
+            string(LENGTH "${bytes}" width)
+            math(EXPR width "7 - ${width}")
+            string(REPEAT " " ${width} pad)
+            set(lines "${pad}${bytes}  ${CMAKE_MATCH_2}\n${lines}") # nm sorts ascending
+        endif()
+    endforeach()
+    math(EXPR total "${total} + ${file_total}")
+    string(APPEND report "${name}: ${file_total} bytes\n${lines}\n")
+endforeach()
+string(APPEND report "total: ${total} bytes of code\n")
+
+message("${report}")
+if(REPORT)
+    file(WRITE ${REPORT} "${report}")
+endif()
@@ -0,0 +1,63 @@
+/**
+ * @file host_benchmark.cpp
+ * @brief Desktop benchmark of BBStateControl, reporting ns/op per case and set size.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ *
+ * Build from the library root with the Arduino shim in extras/host:
+ *
+ *   g++ -O2 -std=gnu++11 -Iextras/host -Isrc -Iexamples/benchmark \
+ *       extras/benchmark/host_benchmark.cpp src/bit_based_state_*.cpp -o bbsc_benchmark
+ *
+ * Add -DBBSC_WORD_BITS=8 to measure the AVR byte kernels, or -DBBSC_INDEX_BITS=8
+ * for the AVR index types. The CMake project next to this file builds the same
+ * benchmark and reports per-function code size from nm (largest first), also
+ * written to build/code_size.txt:
+ *
+ *   cmake -S extras/benchmark -B build -DBBSC_FLAGS="-DBBSC_WORD_BITS=8"
+ *   cmake --build build && cmake --build build --target code_size
+ *
+ * Pass -DBBSC_NM=avr-nm with an AVR toolchain to size the board objects.
+ *
+ * The cases are the ones of examples/benchmark, which reports cycles on a board.
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include "bit_based_state_control.h"
+
+/**
+ * @class HostTimer
+ * @brief Reports each case as one line of "size  ns/op  name".
+ */
+class HostTimer {
+public:
+    void start() { begin = std::chrono::steady_clock::now(); }
+
+    void stop(const char* name, bbsc_index_t size, uint16_t iterations) {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        printf("%6lu  %10.1f  %s\n", (unsigned long)size, ns / iterations, name);
+    }
+
+private:
+    std::chrono::steady_clock::time_point begin;  ///< Start of the running case.
+};
+
+#include "bench_cases.h"
+
+// Runs every case for each set size
+int main() {
+    static const uint32_t SIZES[] = {8, 16, 32, 64, 128, 254, 1024, 4096, 16384};
+    static const uint16_t ITERATIONS = 20000;
+    HostTimer timer;
+    printf("word %d bits, index %d bits\n", BBSC_WORD_BITS, (int)(8 * sizeof(bbsc_index_t)));
+    printf("%6s  %10s  %s\n", "size", "ns/op", "case");
+    for (uint32_t size : SIZES) {
+        if (size > BBSC_MAX_STATES) break;
+        runBenchCases(timer, (bbsc_index_t)size, ITERATIONS);
+    }
+    printf("checksum %lu\n", (unsigned long)benchSink);
+    return 0;
+}
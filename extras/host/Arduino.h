@@ -0,0 +1,65 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core shim to build the library on a desktop compiler.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ *
+ * Provides only what the library sources use: PROGMEM access, the _P string
+ * functions, min()/max(), millis()/micros() and the interrupt macros. Add
+ * `-Iextras/host` to the include path; never put this directory on the path of
+ * a real Arduino build.
+ */
+
+#ifndef BBSC_HOST_ARDUINO_H
+#define BBSC_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <type_traits>
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p) (*(void* const*)(p))
+#define snprintf_P snprintf
+#define strncpy_P strncpy
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+
+// Interrupts do not exist on the host
+#define noInterrupts()
+#define interrupts()
+
+// Arduino's min()/max() without the double evaluation of the macros
+template <class A, class B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+
+template <class A, class B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+
+// Milliseconds since the first call
+inline unsigned long millis() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Microseconds since the first call
+inline unsigned long micros() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+#endif  // BBSC_HOST_ARDUINO_H
@@ -0,0 +1,15 @@
+/**
+ * @file pgmspace.h
+ * @brief Host shim for <avr/pgmspace.h>; the definitions live in the Arduino.h shim.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BBSC_HOST_PGMSPACE_H
+#define BBSC_HOST_PGMSPACE_H
+
+#include <Arduino.h>
+
+#endif  // BBSC_HOST_PGMSPACE_H
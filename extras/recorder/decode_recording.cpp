@@ -0,0 +1,169 @@
+/**
+ * @file decode_recording.cpp
+ * @brief Desktop decoder for BBStateRecorder logs, printing one line per frame.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ *
+ * Build from the library root (only the frame constants of the recorder
+ * header are used, nothing needs linking):
+ *
+ *   g++ -O2 -std=gnu++11 -Isrc extras/recorder/decode_recording.cpp -o bbsc_decode
+ *
+ * Usage:
+ *
+ *   bbsc_decode [-n states] [-c] log.bin
+ *
+ * Each line is "time states", states as '0'/'1' from state 0 (the format of
+ * serializeStates()). -n trims the padding bits of the last byte, -c prints
+ * only the frames that changed something, as "time +i -j ..." for each state
+ * set or cleared. Reads standard input when the file is "-".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "bit_based_state_recorder.h"
+
+/**
+ * @class FrameReader
+ * @brief Walks the frames of a log held in memory.
+ */
+class FrameReader {
+public:
+    FrameReader(const std::vector<uint8_t>& log) : log(log), pos(0) {}
+
+    bool atEnd() const { return pos >= log.size(); }
+    size_t offset() const { return pos; }
+
+    bool byte(uint8_t& value) {
+        if (pos >= log.size()) return false;
+        value = log[pos++];
+        return true;
+    }
+
+    bool varint(uint32_t& value) {
+        value = 0;
+        for (uint8_t shift = 0; shift < 35; shift += 7) {
+            uint8_t b;
+            if (!byte(b)) return false;
+            value |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+private:
+    const std::vector<uint8_t>& log;  ///< Whole log.
+    size_t pos;                       ///< Next byte to read.
+};
+
+// Prints one frame as a bit string, or as its changes
+static void printFrame(uint32_t time, const std::vector<uint8_t>& states, const std::vector<uint8_t>& before,
+                       size_t count, bool changesOnly) {
+    if (!changesOnly) {
+        printf("%lu ", (unsigned long)time);
+        for (size_t i = 0; i < count; i++) {
+            putchar((states[i / 8] >> (i % 8)) & 1 ? '1' : '0');
+        }
+        putchar('\n');
+        return;
+    }
+    bool any = false;
+    for (size_t i = 0; i < count; i++) {
+        bool now = (states[i / 8] >> (i % 8)) & 1;
+        bool was = i / 8 < before.size() && ((before[i / 8] >> (i % 8)) & 1);
+        if (now == was) continue;
+        if (!any) printf("%lu", (unsigned long)time);
+        printf(" %c%lu", now ? '+' : '-', (unsigned long)i);
+        any = true;
+    }
+    if (any) putchar('\n');
+}
+
+// Reads a whole file (or standard input) into memory
+static bool readLog(const char* path, std::vector<uint8_t>& log) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!f) return false;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof chunk, f)) > 0) {
+        log.insert(log.end(), chunk, chunk + n);
+    }
+    if (f != stdin) fclose(f);
+    return true;
+}
+
+// Decodes every frame of a log
+int main(int argc, char** argv) {
+    long states = -1;
+    bool changesOnly = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            states = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            changesOnly = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    std::vector<uint8_t> log;
+    if (!path || !readLog(path, log)) {
+        fprintf(stderr, "usage: %s [-n states] [-c] log.bin\n", argv[0]);
+        return 2;
+    }
+
+    FrameReader in(log);
+    std::vector<uint8_t> current, before;
+    uint32_t time = 0;
+    bool synced = false; // Deltas are skipped until the first keyframe
+    while (!in.atEnd()) {
+        size_t start = in.offset();
+        uint8_t tag;
+        in.byte(tag);
+        before = current;
+        bool ok = true;
+        if (tag == BBStateRecorder::FRAME_PAD) {
+            continue;
+        } else if (tag == BBStateRecorder::FRAME_KEY) {
+            uint8_t b[4];
+            uint32_t bytes = 0;
+            for (uint8_t i = 0; ok && i < 4; i++) ok = in.byte(b[i]);
+            ok = ok && in.varint(bytes);
+            time = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+            current.assign(bytes, 0);
+            for (uint32_t i = 0; ok && i < bytes; i++) ok = in.byte(current[i]);
+            if (!synced) before.clear();
+            synced = true;
+        } else if (tag == BBStateRecorder::FRAME_DELTA || tag == BBStateRecorder::FRAME_SAME) {
+            uint32_t delta = 0, changes = 0;
+            ok = in.varint(delta);
+            if (ok && tag == BBStateRecorder::FRAME_DELTA) ok = in.varint(changes);
+            size_t next = 0;
+            for (uint32_t c = 0; ok && c < changes; c++) {
+                uint32_t gap;
+                uint8_t diff;
+                ok = in.varint(gap) && in.byte(diff);
+                if (!ok || !synced) continue;
+                ok = next + gap < current.size();
+                if (ok) current[next + gap] ^= diff;
+                next += gap + 1;
+            }
+            time += delta;
+            if (!synced) continue;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "bad frame at offset %lu\n", (unsigned long)start);
+            return 1;
+        }
+        size_t count = current.size() * 8;
+        if (states >= 0 && (size_t)states < count) count = (size_t)states;
+        printFrame(time, current, before, count, changesOnly);
+    }
+    return 0;
+}
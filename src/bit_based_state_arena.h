@@ -0,0 +1,113 @@
+/**
+ * @file bit_based_state_arena.h
+ * @brief Bump allocator carving BBStateControl storage out of one contiguous block.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_ARENA_H
+#define BIT_BASED_STATE_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStateArena
+ * @brief Hands out bitfield storage for many BBStateControl objects from one block.
+ *
+ * Each BBStateControl(size, arena) takes its bitfield and saved state,
+ * back to back, from the next free words of the block: no heap allocation,
+ * no fragmentation, and the bitfields of consecutive objects are adjacent in
+ * memory. Storage is never returned individually; reset() reclaims the whole
+ * block once no object built on it is in use.
+ */
+class BBStateArena {
+public:
+    /**
+     * @brief Initializes an arena on a caller-provided block.
+     * @param block Storage for the bitfields (static or global, must outlive the objects).
+     * @param words Size of the block in words.
+     */
+    BBStateArena(bbsc_word_t* block, size_t words) : memory(block), total(block ? words : 0), used(0) {}
+
+    BBStateArena(const BBStateArena&) = delete;
+    BBStateArena& operator=(const BBStateArena&) = delete;
+
+    /**
+     * @brief Gets the words one object takes from an arena.
+     * @param states Number of states (clamped like the BBStateControl constructors).
+     * @param withSavedState True to count the saved state bitfield.
+     * @return Words needed.
+     */
+    static size_t wordsFor(bbsc_index_t states, bool withSavedState = true) {
+        uint32_t n = states > 0 ? states : 1;
+        if (n > BBSC_MAX_STATES) n = BBSC_MAX_STATES;
+        return (size_t)BBSC_WORDS_FOR(n) * (withSavedState ? 2 : 1);
+    }
+
+    /**
+     * @brief Takes storage for one object from the block.
+     * @param states Number of states.
+     * @param withSavedState True to reserve the saved state bitfield after the bitfield.
+     * @return First word of the storage, or nullptr if the block is full.
+     */
+    bbsc_word_t* allocate(bbsc_index_t states, bool withSavedState = true) {
+        size_t n = wordsFor(states, withSavedState);
+        if (n > total - used) return nullptr;
+        bbsc_word_t* storage = memory + used;
+        used += n;
+        return storage;
+    }
+
+    /**
+     * @brief Reclaims the whole block. Objects built on it must no longer be used.
+     */
+    void reset() { used = 0; }
+
+    /**
+     * @brief Gets the number of words handed out.
+     * @return Words in use.
+     */
+    size_t usedWords() const { return used; }
+
+    /**
+     * @brief Gets the number of words still free.
+     * @return Words available.
+     */
+    size_t freeWords() const { return total - used; }
+
+    /**
+     * @brief Gets the size of the block.
+     * @return Words in the block.
+     */
+    size_t capacity() const { return total; }
+
+private:
+    bbsc_word_t* memory;  ///< Storage handed out to objects.
+    size_t total;         ///< Size of the block in words.
+    size_t used;          ///< Words handed out so far.
+};
+
+/**
+ * @class BBStateArenaT
+ * @brief BBStateArena with its block inline, sized at compile time.
+ * @tparam Words Size of the block in words (see BBStateArena::wordsFor()).
+ */
+template <size_t Words>
+class BBStateArenaT : public BBStateArena {
+    static_assert(Words > 0, "BBStateArenaT needs a non-empty block");
+
+public:
+    /**
+     * @brief Initializes an empty arena.
+     */
+    BBStateArenaT() : BBStateArena(storage, Words) {}
+
+private:
+    bbsc_word_t storage[Words];  ///< Inline block.
+};
+
+#endif  // BIT_BASED_STATE_ARENA_H
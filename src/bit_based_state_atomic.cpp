@@ -0,0 +1,105 @@
+/**
+ * @file bit_based_state_atomic.cpp
+ * @brief Implementation of AtomicBBStateControl.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_atomic.h"
+#include "bit_based_state_detail.h"
+#include <Arduino.h>
+
+// Constructor: Allocates and clears the flags
+AtomicBBStateControl::AtomicBBStateControl(bbsc_index_t size)
+    : def_size(size > 0 ? size : 1), word_size(0), array(nullptr), ownsStorage(true) {
+    if (def_size > BBSC_MAX_STATES) def_size = BBSC_MAX_STATES;  // Limit for bbsc_index_t indexing
+    word_size = BBSC_WORDS_FOR(def_size);      // Calculate required words
+    array = new bbsc_word_t[word_size]();
+    if (!array) {
+        def_size = 0;
+        word_size = 0;
+    }
+}
+
+// Constructor: Uses caller-provided storage
+AtomicBBStateControl::AtomicBBStateControl(bbsc_index_t size, volatile bbsc_word_t* storage)
+    : def_size(size > 0 ? size : 1), word_size(0), array(storage), ownsStorage(false) {
+    if (def_size > BBSC_MAX_STATES) def_size = BBSC_MAX_STATES;  // Limit for bbsc_index_t indexing
+    word_size = BBSC_WORDS_FOR(def_size);      // Calculate required words
+    if (!array) {
+        def_size = 0;
+        word_size = 0;
+        return;
+    }
+    clearAll();
+}
+
+// Destructor: Frees allocated memory
+AtomicBBStateControl::~AtomicBBStateControl() {
+    if (ownsStorage) delete[] array;
+}
+
+// Sets a flag
+bool AtomicBBStateControl::set(bbsc_index_t index) {
+    if (!array || index >= def_size) return false;
+    bbsc_word_t bit = (bbsc_word_t)1 << (index & BBSC_WORD_MASK);
+    return (atomicFetchOr(&array[index >> BBSC_WORD_SHIFT], bit) & bit) != 0;
+}
+
+// Clears a flag
+bool AtomicBBStateControl::clear(bbsc_index_t index) {
+    if (!array || index >= def_size) return false;
+    bbsc_word_t bit = (bbsc_word_t)1 << (index & BBSC_WORD_MASK);
+    return (atomicFetchAnd(&array[index >> BBSC_WORD_SHIFT], (bbsc_word_t)~bit) & bit) != 0;
+}
+
+// Toggles a flag
+bool AtomicBBStateControl::toggle(bbsc_index_t index) {
+    if (!array || index >= def_size) return false;
+    bbsc_word_t bit = (bbsc_word_t)1 << (index & BBSC_WORD_MASK);
+    return (atomicFetchXor(&array[index >> BBSC_WORD_SHIFT], bit) & bit) != 0;
+}
+
+// Reads a flag
+bool AtomicBBStateControl::get(bbsc_index_t index) const {
+    if (!array || index >= def_size) return false;
+    return (atomicLoad(&array[index >> BBSC_WORD_SHIFT]) >> (index & BBSC_WORD_MASK)) & 1;
+}
+
+// Checks if any flag is set
+bool AtomicBBStateControl::any() const {
+    if (!array) return false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if (atomicLoad(&array[i])) return true;
+    }
+    return false;
+}
+
+// Clears all flags
+void AtomicBBStateControl::clearAll() {
+    if (!array) return;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        atomicExchangeZero(&array[i]);
+    }
+}
+
+// Drains all flags into another object
+bool AtomicBBStateControl::exchangeAll(BBStateControl& dest) {
+    if (!array || !dest.array || dest.def_size != def_size) return false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        dest.storeWord(i, atomicExchangeZero(&array[i]));
+    }
+    dest.invalidateTrueIndex();
+    dest.endChange();
+    return true;
+}
+
+// Drains all flags into a word buffer
+void AtomicBBStateControl::exchangeAll(bbsc_word_t* out) {
+    if (!array || !out) return;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        out[i] = atomicExchangeZero(&array[i]);
+    }
+}
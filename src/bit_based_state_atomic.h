@@ -0,0 +1,153 @@
+/**
+ * @file bit_based_state_atomic.h
+ * @brief Header for AtomicBBStateControl, an interrupt- and multi-core-safe flag set.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_ATOMIC_H
+#define BIT_BASED_STATE_ATOMIC_H
+
+#include <stdint.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class AtomicBBStateControl
+ * @brief Bitfield of flags that can be set from ISRs or another core and drained in loop().
+ *
+ * Every single-bit operation is an atomic read-modify-write of one word. Targets
+ * without atomic RMW instructions use a short critical section: interrupts
+ * masked on AVR and single-core Cortex-M0/M0+ (SAMD21), and a hardware spinlock
+ * (BBSC_RP2040_SPINLOCK) on dual-core RP2040, so both cores are excluded. Other
+ * 32-bit targets (ESP32, Cortex-M3 and up) use lock-free `__atomic` builtins.
+ * There is no trueIndex to keep consistent: the consumer
+ * drains flags into a regular BBStateControl with exchangeAll().
+ */
+class AtomicBBStateControl {
+public:
+    /**
+     * @brief Initializes the object with a specified number of flags, all clear.
+     * @param size Number of flags to manage (max BBSC_MAX_STATES).
+     */
+    explicit AtomicBBStateControl(bbsc_index_t size);
+
+    /**
+     * @brief Frees allocated memory.
+     */
+    ~AtomicBBStateControl();
+
+    AtomicBBStateControl(const AtomicBBStateControl&) = delete;
+    AtomicBBStateControl& operator=(const AtomicBBStateControl&) = delete;
+
+    /**
+     * @brief Atomically sets a flag.
+     * @param index Index of the flag (0 to def_size-1).
+     * @return Previous value of the flag.
+     */
+    bool set(bbsc_index_t index);
+
+    /**
+     * @brief Atomically clears a flag.
+     * @param index Index of the flag (0 to def_size-1).
+     * @return Previous value of the flag.
+     */
+    bool clear(bbsc_index_t index);
+
+    /**
+     * @brief Atomically toggles a flag.
+     * @param index Index of the flag (0 to def_size-1).
+     * @return Previous value of the flag.
+     */
+    bool toggle(bbsc_index_t index);
+
+    /**
+     * @brief Reads a flag.
+     * @param index Index of the flag (0 to def_size-1).
+     * @return Current value of the flag.
+     */
+    bool get(bbsc_index_t index) const;
+
+    /**
+     * @brief Checks if any flag is set.
+     * @return True if at least one flag is set.
+     */
+    bool any() const;
+
+    /**
+     * @brief Clears all flags.
+     */
+    void clearAll();
+
+    /**
+     * @brief Moves all pending flags into another object and clears them here.
+     *
+     * Each word is swapped with zero in one atomic exchange, so every flag set by
+     * a producer is delivered exactly once. The destination's states are replaced.
+     *
+     * @param dest Object of the same size receiving the flags.
+     * @return True if the sizes match and the flags were moved.
+     */
+    bool exchangeAll(BBStateControl& dest);
+
+    /**
+     * @brief Moves all pending flags into a word buffer and clears them here.
+     * @param out Buffer of at least wordSize() words.
+     */
+    void exchangeAll(bbsc_word_t* out);
+
+    /**
+     * @brief Gets the number of flags.
+     * @return Number of flags managed.
+     */
+    bbsc_index_t size() const { return def_size; }
+
+    /**
+     * @brief Gets the number of storage words.
+     * @return Words needed by exchangeAll(bbsc_word_t*).
+     */
+    bbsc_index_t wordSize() const { return word_size; }
+
+protected:
+    /**
+     * @brief Initializes the object on storage owned by the caller (no heap allocation).
+     * @param size Number of flags to manage (max BBSC_MAX_STATES).
+     * @param storage Storage of at least BBSC_WORDS_FOR(size) words.
+     */
+    AtomicBBStateControl(bbsc_index_t size, volatile bbsc_word_t* storage);
+
+private:
+    bbsc_index_t def_size;              ///< Total number of flags.
+    bbsc_index_t word_size;             ///< Number of words needed for the bitfield.
+    volatile bbsc_word_t* array;   ///< Bitfield shared with ISRs / other cores.
+    bool ownsStorage;              ///< True if array was allocated by this object.
+};
+
+/**
+ * @struct AtomicBBStateStorageT
+ * @brief Inline flag storage for AtomicBBStateControlT, sized at compile time.
+ * @tparam N Number of flags.
+ */
+template <bbsc_index_t N>
+struct AtomicBBStateStorageT {
+    volatile bbsc_word_t bits[BBSC_WORDS_FOR(N)];  ///< Flag storage.
+};
+
+/**
+ * @class AtomicBBStateControlT
+ * @brief AtomicBBStateControl with compile-time size and inline storage.
+ * @tparam N Number of flags to manage (1 to BBSC_MAX_STATES).
+ */
+template <bbsc_index_t N>
+class AtomicBBStateControlT : private AtomicBBStateStorageT<N>, public AtomicBBStateControl {
+    static_assert(N > 0 && N <= BBSC_MAX_STATES, "AtomicBBStateControlT supports 1 to BBSC_MAX_STATES flags");
+
+public:
+    /**
+     * @brief Initializes the object with N flags, all clear.
+     */
+    AtomicBBStateControlT() : AtomicBBStateStorageT<N>(), AtomicBBStateControl(N, this->bits) {}
+};
+
+#endif  // BIT_BASED_STATE_ATOMIC_H
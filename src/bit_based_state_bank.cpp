@@ -0,0 +1,154 @@
+/**
+ * @file bit_based_state_bank.cpp
+ * @brief Implementation of BBStateBank.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_bank.h"
+#include "bit_based_state_detail.h"
+#include <Arduino.h>
+
+// Clamps a count to 1..BBSC_MAX_STATES
+static inline bbsc_index_t clampCount(bbsc_index_t n) {
+    if (n == 0) return 1;
+    if ((uint32_t)n > BBSC_MAX_STATES) return (bbsc_index_t)BBSC_MAX_STATES;
+    return n;
+}
+
+// Constructor: Allocates one lane per state
+BBStateBank::BBStateBank(bbsc_index_t count, bbsc_index_t size)
+    : set_count(clampCount(count)), state_count(clampCount(size)), lane_words(0), lanes(nullptr) {
+    lane_words = BBSC_WORDS_FOR(set_count);
+    lanes = new bbsc_word_t[(size_t)state_count * lane_words]();
+    if (!lanes) {
+        set_count = 0;
+        state_count = 0;
+        lane_words = 0;
+    }
+}
+
+// Destructor: Frees allocated memory
+BBStateBank::~BBStateBank() {
+    delete[] lanes;
+}
+
+// Gets the lane of a state
+const bbsc_word_t* BBStateBank::setsWith(bbsc_index_t index) const {
+    if (index >= state_count) return nullptr;
+    return lanes + (size_t)index * lane_words;
+}
+
+// Gets the first set with a state true
+bbsc_sindex_t BBStateBank::firstSetWith(bbsc_index_t index) const {
+    const bbsc_word_t* lane = setsWith(index);
+    if (!lane) return -1;
+    for (bbsc_index_t i = 0; i < lane_words; i++) {
+        if (lane[i]) return (i << BBSC_WORD_SHIFT) + ctzWord(lane[i]);
+    }
+    return -1;
+}
+
+// Counts the sets with a state true
+bbsc_index_t BBStateBank::countSetsWith(bbsc_index_t index) const {
+    const bbsc_word_t* lane = setsWith(index);
+    if (!lane) return 0;
+    bbsc_index_t count = 0;
+    for (bbsc_index_t i = 0; i < lane_words; i++) {
+        count += popcountWord(lane[i]);
+    }
+    return count;
+}
+
+// Sets a state in every set
+void BBStateBank::setStateInAll(bbsc_index_t index, bool state) {
+    if (index >= state_count) return;
+    bbsc_word_t* lane = lanes + (size_t)index * lane_words;
+    bbsc_word_t fill = state ? (bbsc_word_t)~(bbsc_word_t)0 : 0;
+    for (bbsc_index_t i = 0; i < lane_words; i++) {
+        lane[i] = fill;
+    }
+    lane[lane_words - 1] &= lastWordMask(); // Unused bits stay clear
+}
+
+// Sets a state in the masked sets
+void BBStateBank::setStateIn(bbsc_index_t index, const bbsc_word_t* sets, bool state) {
+    if (index >= state_count || !sets) return;
+    bbsc_word_t* lane = lanes + (size_t)index * lane_words;
+    for (bbsc_index_t i = 0; i < lane_words; i++) {
+        lane[i] = state ? (bbsc_word_t)(lane[i] | sets[i]) : (bbsc_word_t)(lane[i] & ~sets[i]);
+    }
+    lane[lane_words - 1] &= lastWordMask();
+}
+
+// Resets every lane
+void BBStateBank::resetAll() {
+    for (size_t i = 0; i < (size_t)state_count * lane_words; i++) {
+        lanes[i] = 0;
+    }
+}
+
+// Constructor: Locates the bit of a set in every lane
+BBStateBank::Set::Set(BBStateBank* bank, bbsc_index_t set)
+    : bank(bank->lanes && set < bank->set_count ? bank : nullptr),
+      word(set >> BBSC_WORD_SHIFT), bit((bbsc_word_t)((bbsc_word_t)1 << (set & BBSC_WORD_MASK))) {}
+
+// Sets a state of the set to a specific value
+void BBStateBank::Set::setState(bbsc_index_t index, bool state, bool exclusive) {
+    if (!bank || index >= bank->state_count) return;
+    if (state && exclusive) {
+        for (bbsc_index_t i = 0; i < bank->state_count; i++) {
+            at(i) &= (bbsc_word_t)~bit;
+        }
+    }
+    if (state) {
+        at(index) |= bit;
+    } else {
+        at(index) &= (bbsc_word_t)~bit;
+    }
+}
+
+// Toggles a state of the set
+void BBStateBank::Set::toggleState(bbsc_index_t index) {
+    if (!bank || index >= bank->state_count) return;
+    if (at(index) & bit) {
+        at(index) &= (bbsc_word_t)~bit;
+    } else {
+        setState(index, true, true); // Turning on is exclusive, as in BBStateControl
+    }
+}
+
+// Resets every state of the set
+void BBStateBank::Set::resetArray() {
+    if (!bank) return;
+    for (bbsc_index_t i = 0; i < bank->state_count; i++) {
+        at(i) &= (bbsc_word_t)~bit;
+    }
+}
+
+// Gets a state of the set
+bool BBStateBank::Set::getState(bbsc_index_t index) const {
+    if (!bank || index >= bank->state_count) return false;
+    return (at(index) & bit) != 0;
+}
+
+// Gets the first true state of the set
+bbsc_sindex_t BBStateBank::Set::getFirstTrueIndex() const {
+    if (!bank) return -1;
+    for (bbsc_index_t i = 0; i < bank->state_count; i++) {
+        if (at(i) & bit) return i;
+    }
+    return -1;
+}
+
+// Counts the true states of the set
+bbsc_index_t BBStateBank::Set::countTrueStates() const {
+    if (!bank) return 0;
+    bbsc_index_t count = 0;
+    for (bbsc_index_t i = 0; i < bank->state_count; i++) {
+        if (at(i) & bit) count++;
+    }
+    return count;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file bit_based_state_bank.h
+ * @brief Many same-size state sets stored transposed (structure of arrays).
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_BANK_H
+#define BIT_BASED_STATE_BANK_H
+
+#include <stdint.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStateBank
+ * @brief Keeps K state sets of the same size with state i of every set packed together.
+ *
+ * Instead of one bitfield per set, the bank keeps one lane per state: bit k of
+ * lane i is state i of set k. Questions across sets ("which sets have state i",
+ * "clear state i everywhere", "how many sets have state i") are then a few
+ * word operations on one lane, whatever the number of sets. Each set is still
+ * reachable through a Set view with the usual setState()/getState()/
+ * getFirstTrueIndex() calls; per-set scans and exclusive writes touch one word
+ * per state, so use separate BBStateControl objects when those dominate.
+ */
+class BBStateBank {
+public:
+    /**
+     * @class Set
+     * @brief View of one set of the bank (cheap to copy, valid while the bank lives).
+     */
+    class Set {
+    public:
+        /**
+         * @brief Sets a state to true.
+         * @param index Index of the state (0 to stateCount()-1).
+         * @param exclusive If true, clears the other states of this set.
+         */
+        void setState(bbsc_index_t index, bool exclusive = true) { setState(index, true, exclusive); }
+
+        /**
+         * @brief Sets a state to a specified value.
+         * @param index Index of the state (0 to stateCount()-1).
+         * @param state Value to set (true/false).
+         * @param exclusive If true, clears the other states of this set.
+         */
+        void setState(bbsc_index_t index, bool state, bool exclusive = true);
+
+        /**
+         * @brief Toggles a state. Turning it on clears the other states of this set.
+         * @param index Index of the state (0 to stateCount()-1).
+         */
+        void toggleState(bbsc_index_t index);
+
+        /**
+         * @brief Resets every state of this set to false.
+         */
+        void resetArray();
+
+        /**
+         * @brief Gets the value of a state.
+         * @param index Index of the state (0 to stateCount()-1).
+         * @return True if the state is active, false otherwise.
+         */
+        bool getState(bbsc_index_t index) const;
+
+        /**
+         * @brief Gets the index of the first true state.
+         * @return Index of the first true state, or -1 if none.
+         */
+        bbsc_sindex_t getFirstTrueIndex() const;
+
+        /**
+         * @brief Counts the true states of this set.
+         * @return Number of true states.
+         */
+        bbsc_index_t countTrueStates() const;
+
+    private:
+        friend class BBStateBank;
+
+        Set(BBStateBank* bank, bbsc_index_t set);
+
+        BBStateBank* bank;  ///< Bank holding the lanes (nullptr for an invalid set).
+        bbsc_index_t word;  ///< Lane word holding this set's bit.
+        bbsc_word_t bit;    ///< Mask of this set's bit in that word.
+
+        /**
+         * @brief Gets the lane word holding this set's bit for a state.
+         * @param index State index (validated).
+         * @return Reference to the word.
+         */
+        bbsc_word_t& at(bbsc_index_t index) const { return bank->lanes[(size_t)index * bank->lane_words + word]; }
+    };
+
+    /**
+     * @brief Initializes a bank of sets with every state false.
+     * @param count Number of sets (max BBSC_MAX_STATES).
+     * @param size Number of states per set (max BBSC_MAX_STATES).
+     */
+    BBStateBank(bbsc_index_t count, bbsc_index_t size);
+
+    /**
+     * @brief Frees allocated memory.
+     */
+    ~BBStateBank();
+
+    BBStateBank(const BBStateBank&) = delete;
+    BBStateBank& operator=(const BBStateBank&) = delete;
+
+    /**
+     * @brief Gets a view of one set.
+     * @param set Set index (0 to setCount()-1); an invalid index gives a view that ignores writes.
+     * @return View of the set.
+     */
+    Set set(bbsc_index_t set) { return Set(this, set); }
+
+    /**
+     * @brief Gets a view of one set.
+     * @param set Set index (0 to setCount()-1).
+     * @return View of the set.
+     */
+    Set operator[](bbsc_index_t set) { return Set(this, set); }
+
+    /**
+     * @brief Gets the sets that have a state true.
+     * @param index Index of the state (0 to stateCount()-1).
+     * @return laneWords() words, bit k set if set k has the state (nullptr if invalid).
+     */
+    const bbsc_word_t* setsWith(bbsc_index_t index) const;
+
+    /**
+     * @brief Gets the first set that has a state true.
+     * @param index Index of the state (0 to stateCount()-1).
+     * @return Set index, or -1 if none.
+     */
+    bbsc_sindex_t firstSetWith(bbsc_index_t index) const;
+
+    /**
+     * @brief Counts the sets that have a state true.
+     * @param index Index of the state (0 to stateCount()-1).
+     * @return Number of sets.
+     */
+    bbsc_index_t countSetsWith(bbsc_index_t index) const;
+
+    /**
+     * @brief Sets a state to the same value in every set.
+     * @param index Index of the state (0 to stateCount()-1).
+     * @param state Value to set (true/false).
+     */
+    void setStateInAll(bbsc_index_t index, bool state);
+
+    /**
+     * @brief Sets a state in the sets selected by a mask.
+     * @param index Index of the state (0 to stateCount()-1).
+     * @param sets laneWords() words, bit k set to write set k.
+     * @param state Value to set (true/false).
+     */
+    void setStateIn(bbsc_index_t index, const bbsc_word_t* sets, bool state);
+
+    /**
+     * @brief Resets every state of every set to false.
+     */
+    void resetAll();
+
+    /**
+     * @brief Gets the number of sets.
+     * @return Sets in the bank (0 if allocation failed).
+     */
+    bbsc_index_t setCount() const { return set_count; }
+
+    /**
+     * @brief Gets the number of states per set.
+     * @return States per set (0 if allocation failed).
+     */
+    bbsc_index_t stateCount() const { return state_count; }
+
+    /**
+     * @brief Gets the number of words in one lane.
+     * @return Words returned by setsWith().
+     */
+    bbsc_index_t laneWords() const { return lane_words; }
+
+private:
+    bbsc_index_t set_count;    ///< Number of sets.
+    bbsc_index_t state_count;  ///< Number of states per set.
+    bbsc_index_t lane_words;   ///< Words per lane (one bit per set).
+    bbsc_word_t* lanes;        ///< state_count lanes of lane_words words each.
+
+    /**
+     * @brief Gets the mask of the valid bits in the last word of a lane.
+     * @return Mask with one bit per set of the last word.
+     */
+    bbsc_word_t lastWordMask() const {
+        uint8_t used = set_count & BBSC_WORD_MASK;
+        return used ? (bbsc_word_t)(((bbsc_word_t)1 << used) - 1) : (bbsc_word_t)~(bbsc_word_t)0;
+    }
+};
+
+#endif  // BIT_BASED_STATE_BANK_H
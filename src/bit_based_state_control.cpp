@@ -8,272 +8,1675 @@
  */
 
 #include "bit_based_state_control.h"
+#include "bit_based_state_arena.h"
+#include "bit_based_state_detail.h"
 #include <avr/pgmspace.h>
-#include <Arduino.h> 
+#include <Arduino.h>
 
 // Strings stored in program memory for debugging
 static const char NOT_INDEX[] PROGMEM = "- unassigned";
 static const char INDEX[] PROGMEM = " assigned";
 
+// trueIndex value meaning "recompute on next read"
+static const bbsc_sindex_t TRUE_INDEX_DIRTY = -2;
+
+// changeIndex value meaning "nothing changed since the last notification"
+static const bbsc_sindex_t NO_CHANGE = -2;
+
+// pendingExclusive value meaning "no exclusive request pending" (never a valid index)
+static const bbsc_index_t NO_PENDING = (bbsc_index_t)~(bbsc_index_t)0;
+
+// Binary frame format
+static const uint8_t BINARY_VERSION = 0x01;      // Low nibble of the flags byte
+static const uint8_t BINARY_FLAG_CRC = 0x80;     // Frame ends with a CRC-8 byte
+static const uint8_t FIELD_WIDTH_SHIFT = 4;      // Bits 4-5: field width code
+
+// Delta encoding modes (low nibble of the mode byte)
+static const uint8_t DELTA_INDICES = 0;  // One field per changed index
+static const uint8_t DELTA_RUNS = 1;     // (start, length) per run of changes
+static const uint8_t DELTA_BITMAP = 2;   // Raw XOR bitmap
+
+// Range write operations
+static const uint8_t RANGE_CLEAR = 0;
+static const uint8_t RANGE_SET = 1;
+static const uint8_t RANGE_TOGGLE = 2;
+
+// Hexadecimal digits for serializeHex()
+static const char HEX_DIGITS[] PROGMEM = "0123456789ABCDEF";
+
+#if BBSC_STATS
+// Instrumentation counters shared by every object
+static BBStateStats statsData;
+#endif
+
+// Counts one call of an operation type (nothing without BBSC_STATS)
+#define STAT_OP(op) BBSC_STAT(statsData.ops[BBStateStats::op]++)
+
+// Mask of the range bits inside word i (first/last are the words holding start/end)
+static inline bbsc_word_t rangeMask(bbsc_index_t i, bbsc_index_t first, bbsc_index_t last,
+                                    bbsc_index_t start, bbsc_index_t end) {
+    const bbsc_word_t ones = (bbsc_word_t)~(bbsc_word_t)0;
+    bbsc_word_t mask = ones;
+    if (i == first) mask &= (bbsc_word_t)(ones << (start & BBSC_WORD_MASK));                // Head
+    if (i == last) mask &= (bbsc_word_t)(ones >> (BBSC_WORD_MASK - (end & BBSC_WORD_MASK))); // Tail
+    return mask;
+}
+
+// Bytes used by size/index fields in binary and delta frames
+static inline uint8_t fieldWidth(bbsc_index_t size) {
+    uint32_t n = size;
+    if (n <= 0xFE) return 1;
+    if (n <= 0xFFFE) return 2;
+    return 4;
+}
+
+// Encodes a field width (1, 2 or 4 bytes) as a 2-bit code
+static inline uint8_t widthCode(uint8_t width) {
+    return width == 1 ? 0 : (width == 2 ? 1 : 2);
+}
+
+// Field value meaning "no index" for a field width
+static inline uint32_t noneField(uint8_t width) {
+    return width == 4 ? 0xFFFFFFFFUL : ((1UL << (8 * width)) - 1);
+}
+
+// Writes a little-endian field
+static inline void putField(uint8_t* out, uint32_t value, uint8_t width) {
+    for (uint8_t i = 0; i < width; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+// Reads a little-endian field
+static inline uint32_t getField(const uint8_t* in, uint8_t width) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < width; i++) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
 // Constructor: Initializes bitfield and saved state
-BBStateControl::BBStateControl(uint8_t size)
-    : def_size(size > 0 ? size : 1), byte_size((size + 7) >> 3),
-      array(nullptr), savedState(nullptr), trueIndex(-1), savedTrueIndex(-1) {
-    if (def_size > 254) def_size = 254; // Limit for uint8_t indexing
-    byte_size = (def_size + 7) >> 3;    // Calculate required bytes
-    array = new uint8_t[byte_size]();
+BBStateControl::BBStateControl(bbsc_index_t size)
+    : BBStateControl(size, true) {}
+
+// Constructor: Initializes bitfield and, if requested, saved state
+BBStateControl::BBStateControl(bbsc_index_t size, bool withSavedState)
+    : def_size(size > 0 ? size : 1), word_size(0),
+      array(nullptr), savedState(nullptr), trueIndex(-1), savedTrueIndex(-1),
+      batchDepth(0), pendingExclusive(NO_PENDING), pendingKeepCount(0), ownsStorage(true), inlineStorage(false),
+      summary(nullptr), rankTable(nullptr), rankDirty(true), dirty(nullptr),
+      observer(nullptr), observerContext(nullptr), changeIndex(NO_CHANGE),
+      groups(nullptr), group_count(0) {
+    if (def_size > BBSC_MAX_STATES) def_size = BBSC_MAX_STATES;  // Limit for bbsc_index_t indexing
+    word_size = BBSC_WORDS_FOR(def_size);      // Calculate required words
+    array = new bbsc_word_t[word_size]();
+    BBSC_STAT(statsData.allocations++);
     if (!array) {
         def_size = 0;
-        byte_size = 0;
+        word_size = 0;
         return;
     }
-    savedState = new uint8_t[byte_size]();
+    if (!withSavedState) return;
+    savedState = new bbsc_word_t[word_size]();
+    BBSC_STAT(statsData.allocations++);
     if (!savedState) {
         delete[] array;
         array = nullptr;
         def_size = 0;
-        byte_size = 0;
+        word_size = 0;
+    }
+}
+
+// Constructor: Uses caller-provided bitfield and saved state storage
+BBStateControl::BBStateControl(bbsc_index_t size, bbsc_word_t* storage, bbsc_word_t* saved)
+    : def_size(size > 0 ? size : 1), word_size(0),
+      array(storage), savedState(saved), trueIndex(-1), savedTrueIndex(-1),
+      batchDepth(0), pendingExclusive(NO_PENDING), pendingKeepCount(0), ownsStorage(false), inlineStorage(false),
+      summary(nullptr), rankTable(nullptr), rankDirty(true), dirty(nullptr),
+      observer(nullptr), observerContext(nullptr), changeIndex(NO_CHANGE),
+      groups(nullptr), group_count(0) {
+    if (def_size > BBSC_MAX_STATES) def_size = BBSC_MAX_STATES;  // Limit for bbsc_index_t indexing
+    word_size = BBSC_WORDS_FOR(def_size);      // Calculate required words
+    if (!array) {
+        def_size = 0;
+        word_size = 0;
+        return;
+    }
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        array[i] = 0;
+        if (savedState) savedState[i] = 0;
+    }
+}
+
+// Constructor: Takes bitfield and saved state storage from an arena
+BBStateControl::BBStateControl(bbsc_index_t size, BBStateArena& arena, bool withSavedState)
+    : BBStateControl(size, arena.allocate(size, withSavedState), nullptr) {
+    if (!array || !withSavedState) return;
+    savedState = array + word_size; // Saved state follows the bitfield
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        savedState[i] = 0;
     }
 }
 
 // Destructor: Frees allocated memory
 BBStateControl::~BBStateControl() {
-    delete[] array;
-    delete[] savedState;
+    release();
+}
+
+// Move constructor: Starts empty and takes the other object's storage (if it can move)
+BBStateControl::BBStateControl(BBStateControl&& other)
+    : def_size(0), word_size(0),
+      array(nullptr), savedState(nullptr), trueIndex(-1), savedTrueIndex(-1),
+      batchDepth(0), pendingExclusive(NO_PENDING), pendingKeepCount(0), ownsStorage(true), inlineStorage(false),
+      summary(nullptr), rankTable(nullptr), rankDirty(true), dirty(nullptr),
+      observer(nullptr), observerContext(nullptr), changeIndex(NO_CHANGE),
+      groups(nullptr), group_count(0) {
+    swap(other);
+}
+
+// Move assignment: Frees this object's storage and takes the other's
+BBStateControl& BBStateControl::operator=(BBStateControl&& other) {
+    if (this == &other || !swap(other)) return *this;
+    other.release(); // Frees what this object owned before
+    return *this;
+}
+
+// Frees allocated memory and leaves zero states
+void BBStateControl::release() {
+    delete[] summary;
+    delete[] rankTable;
+    delete[] dirty;
+    delete[] groups;
+    if (ownsStorage) {
+        delete[] array;
+        delete[] savedState;
+    }
+    def_size = 0;
+    word_size = 0;
+    array = nullptr;
+    savedState = nullptr;
+    trueIndex = -1;
+    savedTrueIndex = -1;
+    batchDepth = 0;
+    pendingExclusive = NO_PENDING;
+    pendingKeepCount = 0;
+    ownsStorage = true;
+    summary = nullptr;
+    rankTable = nullptr;
+    rankDirty = true;
+    dirty = nullptr;
+    observer = nullptr;
+    observerContext = nullptr;
+    changeIndex = NO_CHANGE;
+    groups = nullptr;
+    group_count = 0;
+}
+
+// Exchanges two values of any member type
+template <typename T>
+static inline void swapValues(T& a, T& b) {
+    T t = a;
+    a = b;
+    b = t;
+}
+
+// Exchanges every member with another object
+bool BBStateControl::swap(BBStateControl& other) {
+    if (inlineStorage || other.inlineStorage) return false; // Storage cannot leave a BBStateControlT
+    swapValues(def_size, other.def_size);
+    swapValues(word_size, other.word_size);
+    swapValues(array, other.array);
+    swapValues(savedState, other.savedState);
+    swapValues(trueIndex, other.trueIndex);
+    swapValues(savedTrueIndex, other.savedTrueIndex);
+    swapValues(batchDepth, other.batchDepth);
+    swapValues(pendingExclusive, other.pendingExclusive);
+    for (uint8_t i = 0; i < PENDING_KEEP; i++) swapValues(pendingKeep[i], other.pendingKeep[i]);
+    swapValues(pendingKeepCount, other.pendingKeepCount);
+    swapValues(ownsStorage, other.ownsStorage);
+    swapValues(summary, other.summary);
+    swapValues(rankTable, other.rankTable);
+    swapValues(rankDirty, other.rankDirty);
+    swapValues(dirty, other.dirty);
+    swapValues(observer, other.observer);
+    swapValues(observerContext, other.observerContext);
+    swapValues(changeIndex, other.changeIndex);
+    swapValues(groups, other.groups);
+    swapValues(group_count, other.group_count);
+    return true;
+}
+
+// Mask of the bits used in the last word
+bbsc_word_t BBStateControl::lastWordMask() const {
+    uint8_t bits_in_last = def_size & BBSC_WORD_MASK;
+    return bits_in_last ? (bbsc_word_t)(((bbsc_word_t)1 << bits_in_last) - 1)
+                        : (bbsc_word_t)~(bbsc_word_t)0;
 }
 
 // Sets a bit at the given index
-void BBStateControl::setBit(uint8_t index, bool state) {
+void BBStateControl::setBit(bbsc_index_t index, bool state) {
     if (!isValidIndex(index)) return;
-    uint8_t byte = index >> 3;  // Byte index (index / 8)
-    uint8_t bit = index & 0x07; // Bit position (index % 8)
-    if (state) {
-        array[byte] |= (1 << bit);
+    bbsc_index_t word = index >> BBSC_WORD_SHIFT;                    // Word index
+    bbsc_word_t bit = (bbsc_word_t)1 << (index & BBSC_WORD_MASK); // Bit mask in word
+    storeWord(word, state ? (bbsc_word_t)(array[word] | bit) : (bbsc_word_t)(array[word] & ~bit));
+}
+
+// Writes one word and records what changed
+void BBStateControl::storeWord(bbsc_index_t word, bbsc_word_t value) {
+    bbsc_word_t diff = array[word] ^ value;
+    if (!diff) {
+        BBSC_STAT(statsData.wordsUnchanged++);
+        return;
+    }
+    BBSC_STAT(statsData.wordsWritten++);
+    array[word] = value;
+    noteWordChange(word, diff);
+}
+
+// Records a change already written to a word
+void BBStateControl::noteWordChange(bbsc_index_t word, bbsc_word_t diff) {
+    rankDirty = true;
+    if (summary) updateSummary(word);
+    if (dirty) dirty[word] |= diff;
+    if (changeIndex == NO_CHANGE && !(diff & (bbsc_word_t)(diff - 1))) {
+        changeIndex = (word << BBSC_WORD_SHIFT) + ctzWord(diff); // First change, single state
     } else {
-        array[byte] &= ~(1 << bit);
+        changeIndex = -1; // Several states changed
+    }
+}
+
+// Writes the same value to every word
+void BBStateControl::fillWords(bbsc_word_t fill) {
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, i == word_size - 1 ? (bbsc_word_t)(fill & lastWordMask()) : fill);
     }
 }
 
+// Notifies the observer once per operation (or once per batch)
+void BBStateControl::endChange() {
+    if (batchDepth > 0 || changeIndex == NO_CHANGE) return;
+    bbsc_sindex_t index = changeIndex;
+    changeIndex = NO_CHANGE;
+    if (observer) observer(index, observerContext);
+}
+
 // Gets the value of a bit
-bool BBStateControl::getBit(uint8_t index) const {
+bool BBStateControl::getBit(bbsc_index_t index) const {
     if (!isValidIndex(index)) return false;
-    uint8_t byte = index >> 3;
-    uint8_t bit = index & 0x07;
-    return (array[byte] & (1 << bit)) != 0;
+    return (array[index >> BBSC_WORD_SHIFT] >> (index & BBSC_WORD_MASK)) & 1;
 }
 
 // Sets a state to true
-void BBStateControl::setState(uint8_t index, bool exclusive) {
+void BBStateControl::setState(bbsc_index_t index, bool exclusive) {
     setState(index, true, exclusive);
 }
 
 // Sets a state to a specific value
-void BBStateControl::setState(uint8_t index, bool state, bool exclusive) {
+void BBStateControl::setState(bbsc_index_t index, bool state, bool exclusive) {
+    STAT_OP(OP_SET_STATE);
     if (!isValidIndex(index)) return;
+    if (state) keepAfterPending(index);
     setBit(index, state);
     if (state) {
         trueIndex = index;
-        if (exclusive) clearOthers(index);
-    } else if (index == trueIndex) {
-        trueIndex = getFirstTrueIndex();
+        noteGroupActive(index);
+        if (exclusive) applyExclusive(index);
+    } else if ((bbsc_sindex_t)index == trueIndex) {
+        trueIndex = TRUE_INDEX_DIRTY; // Recomputed on next read
     }
+    endChange();
 }
 
 // Saves the current state
 void BBStateControl::saveState() {
-    if (!array || !savedState || byte_size == 0) return;
-    for (uint8_t i = 0; i < byte_size; i++) {
+    STAT_OP(OP_BULK);
+    if (!array || !savedState || word_size == 0) return;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
         savedState[i] = array[i];
     }
-    savedTrueIndex = trueIndex;
+    savedTrueIndex = resolvedTrueIndex();
 }
 
 // Restores the saved state
 void BBStateControl::restoreSavedState() {
-    if (!array || !savedState || byte_size == 0) return;
-    for (uint8_t i = 0; i < byte_size; i++) {
-        array[i] = savedState[i];
+    STAT_OP(OP_BULK);
+    if (!array || !savedState || word_size == 0) return;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, savedState[i]);
     }
     trueIndex = savedTrueIndex;
+    pendingExclusive = NO_PENDING;
+    endChange();
+}
+
+// Exchanges the current and saved bitfields
+void BBStateControl::swapWithSaved() {
+    STAT_OP(OP_BULK);
+    if (!array || !savedState || word_size == 0) return;
+    bbsc_sindex_t current = resolvedTrueIndex();
+    if (ownsStorage) {
+        swapValues(array, savedState);
+        for (bbsc_index_t i = 0; i < word_size; i++) {
+            bbsc_word_t diff = array[i] ^ savedState[i];
+            if (diff) noteWordChange(i, diff);
+        }
+    } else {
+        for (bbsc_index_t i = 0; i < word_size; i++) {
+            bbsc_word_t previous = array[i];
+            storeWord(i, savedState[i]); // Caller's buffers stay where data() points
+            savedState[i] = previous;
+        }
+    }
+    trueIndex = savedTrueIndex;
+    savedTrueIndex = current;
+    pendingExclusive = NO_PENDING;
+    endChange();
 }
 
 // Toggles a state
-void BBStateControl::toggleState(uint8_t index) {
+void BBStateControl::toggleState(bbsc_index_t index) {
+    STAT_OP(OP_TOGGLE);
     if (!isValidIndex(index)) return;
-    bool new_state = !getBit(index);
+    bool new_state = !getBit(index) || pendingClears(index); // A state commit() clears counts as false
+    if (new_state) keepAfterPending(index);
     setBit(index, new_state);
     if (new_state) {
         trueIndex = index;
-        clearOthers(index);
-    } else if (index == trueIndex) {
-        trueIndex = getFirstTrueIndex();
+        noteGroupActive(index);
+        applyExclusive(index);
+    } else if ((bbsc_sindex_t)index == trueIndex) {
+        trueIndex = TRUE_INDEX_DIRTY; // Recomputed on next read
     }
+    endChange();
 }
 
 // Resets all states to false
 void BBStateControl::resetArray() {
-    if (!array || byte_size == 0) return;
-    for (uint8_t i = 0; i < byte_size; i++) {
-        array[i] = 0;
-    }
+    STAT_OP(OP_BULK);
+    if (!array || word_size == 0) return;
+    fillWords(0);
     trueIndex = -1;
+    pendingExclusive = NO_PENDING;
+    endChange();
 }
 
 // Sets all states to a value
 void BBStateControl::setAllStates(bool state) {
-    if (!array || byte_size == 0) return;
-    for (uint8_t i = 0; i < byte_size; i++) {
-        array[i] = state ? 0xFF : 0;
-    }
+    STAT_OP(OP_BULK);
+    if (!array || word_size == 0) return;
+    fillWords(state ? (bbsc_word_t)~(bbsc_word_t)0 : 0); // Unused bits stay clear
     trueIndex = state ? 0 : -1;
+    pendingExclusive = NO_PENDING;
+    endChange();
 }
 
 // Sets the first state to true
 void BBStateControl::setDefaultIndex() {
-    if (!array || byte_size == 0) return;
-    resetArray();
+    STAT_OP(OP_BULK);
+    if (!array || word_size == 0) return;
+    clearOthers(0);
     setBit(0, true);
     trueIndex = 0;
+    pendingExclusive = NO_PENDING;
+    endChange();
 }
 
 // Gets a state value
-bool BBStateControl::getState(uint8_t index) const {
+bool BBStateControl::getState(bbsc_index_t index) const {
     return getBit(index);
 }
 
 // Finds the first true state
-int8_t BBStateControl::getFirstTrueIndex() const {
+bbsc_sindex_t BBStateControl::getFirstTrueIndex() const {
+    STAT_OP(OP_FIND);
     if (!array) return -1;
-    for (uint8_t i = 0; i < def_size; i++) {
-        if (getBit(i)) return i;
-    }
-    return -1;
+    bbsc_index_t i = nextWord(0, true);
+    if (i >= word_size) return -1;
+    return (i << BBSC_WORD_SHIFT) + ctzWord(array[i]);
 }
 
 // Gets all true state indices
-uint8_t* BBStateControl::getAllTrueIndices(uint8_t& count) const {
-    if (!array || byte_size == 0) {
+bbsc_index_t* BBStateControl::getAllTrueIndices(bbsc_index_t& count) const {
+    if (!array || word_size == 0) {
         count = 0;
         return nullptr;
     }
     count = countTrueStates();
     if (count == 0) return nullptr;
 
-    uint8_t* indices = new uint8_t[count];
+    bbsc_index_t* indices = new bbsc_index_t[count];
+    BBSC_STAT(statsData.allocations++);
     if (!indices) {
         count = 0;
         return nullptr;
     }
+    getAllTrueIndices(indices, count);
+    return indices;
+}
 
-    uint8_t pos = 0;
-    for (uint8_t i = 0; i < def_size; i++) {
-        if (getBit(i)) indices[pos++] = i;
+#if BBSC_INDEX_BITS != 8
+// Returns an allocated array of true state indices narrowed to bytes
+uint8_t* BBStateControl::getAllTrueIndices(uint8_t& count) const {
+    count = 0;
+    bbsc_index_t total;
+    bbsc_index_t* wide = getAllTrueIndices(total);
+    if (!wide) return nullptr;
+    uint8_t* indices = nullptr;
+    if (total <= 0xFF && wide[total - 1] <= 0xFF) { // Ascending, so the last index is the largest
+        indices = new uint8_t[total];
+        BBSC_STAT(statsData.allocations++);
+    }
+    if (indices) {
+        for (bbsc_index_t i = 0; i < total; i++) indices[i] = (uint8_t)wide[i];
+        count = (uint8_t)total;
     }
+    delete[] wide;
     return indices;
 }
+#endif
+
+// Writes true state indices into a caller buffer
+bbsc_index_t BBStateControl::getAllTrueIndices(bbsc_index_t* out, bbsc_index_t cap) const {
+    if (!out || cap == 0) return 0;
+    bbsc_index_t pos = 0;
+    for (TrueIterator it = TrueIterator(this, false), end = TrueIterator(this, true);
+         it != end && pos < cap; ++it) {
+        out[pos++] = *it;
+    }
+    return pos;
+}
+
+// Calls a function for each true state
+void BBStateControl::forEachTrue(TrueCallback callback, void* context) const {
+    if (!callback) return;
+    for (bbsc_index_t index : trueIndices()) {
+        callback(index, context);
+    }
+}
+
+// Iterator: Positioned on the first visited state, or at the end
+BBStateControl::TrueIterator::TrueIterator(const BBStateControl* source, bool atEnd, uint8_t view)
+    : owner(source), word(0), bits(0), index(0), view(view) {
+    if (atEnd || !owner->array || owner->word_size == 0 ||
+        (view == VIEW_DIRTY ? !owner->dirty : view != VIEW_TRUE && !owner->savedState)) {
+        word = owner->word_size;
+        return;
+    }
+    bits = owner->viewWord(view, 0);
+    settle();
+}
+
+// Iterator: Skips zero words and computes the current index
+void BBStateControl::TrueIterator::settle() {
+    while (!bits) {
+        word = view == VIEW_TRUE ? owner->nextWord(word + 1, true) : word + 1;
+        if (word >= owner->word_size) {
+            word = owner->word_size;
+            return;
+        }
+        bits = owner->viewWord(view, word);
+    }
+    index = (word << BBSC_WORD_SHIFT) + ctzWord(bits);
+}
 
 // Generates a string with the true index
 void BBStateControl::getIndex(char* buffer, uint8_t bufSize) const {
     if (!buffer || bufSize == 0) return;
-    if (trueIndex >= 0) {
-        snprintf_P(buffer, bufSize, PSTR("%d%s"), trueIndex, INDEX);
+    bbsc_sindex_t index = resolvedTrueIndex();
+    if (index >= 0) {
+        snprintf_P(buffer, bufSize, PSTR("%ld%s"), (long)index, INDEX);
     } else {
         strncpy_P(buffer, NOT_INDEX, bufSize);
     }
     buffer[bufSize - 1] = '\0';
 }
 
+// Gets the current true index
+bbsc_sindex_t BBStateControl::getTrueIndex() const {
+    return resolvedTrueIndex();
+}
+
 // Finds a state with the given value
-int8_t BBStateControl::findState(bool state) const {
+bbsc_sindex_t BBStateControl::findState(bool state) const {
     if (!array) return -1;
-    for (uint8_t i = 0; i < def_size; i++) {
-        if (getBit(i) == state) return i;
+    if (state) return getFirstTrueIndex();
+    STAT_OP(OP_FIND);
+    bbsc_index_t i = nextWord(0, false);
+    if (i >= word_size) return -1;
+    bbsc_word_t valid = (i == word_size - 1) ? lastWordMask() : (bbsc_word_t)~(bbsc_word_t)0;
+    return (i << BBSC_WORD_SHIFT) + ctzWord((bbsc_word_t)~array[i] & valid);
+}
+
+// Finds a state with the given value, starting at an index
+bbsc_sindex_t BBStateControl::findState(bool state, bbsc_index_t start) const {
+    STAT_OP(OP_FIND);
+    if (!array || start >= def_size) return -1;
+    bbsc_index_t i = start >> BBSC_WORD_SHIFT;
+    bbsc_word_t head = (bbsc_word_t)~(bbsc_word_t)0 << (start & BBSC_WORD_MASK); // Skip bits before start
+    for (;;) {
+        bbsc_word_t valid = (i == word_size - 1) ? lastWordMask() : (bbsc_word_t)~(bbsc_word_t)0;
+        bbsc_word_t w = (state ? array[i] : (bbsc_word_t)~array[i]) & valid & head;
+        if (w) return (i << BBSC_WORD_SHIFT) + ctzWord(w);
+        i = nextWord(i + 1, state);
+        if (i >= word_size) return -1;
+        head = (bbsc_word_t)~(bbsc_word_t)0;
     }
-    return -1;
+}
+
+// Finds the next true state after an index
+bbsc_sindex_t BBStateControl::nextTrue(bbsc_sindex_t after) const {
+    if (after < -1) after = -1;
+    if (after + 1 >= (bbsc_sindex_t)def_size) return -1;
+    return findState(true, (bbsc_index_t)(after + 1));
+}
+
+// Finds the next false state after an index
+bbsc_sindex_t BBStateControl::nextFalse(bbsc_sindex_t after) const {
+    if (after < -1) after = -1;
+    if (after + 1 >= (bbsc_sindex_t)def_size) return -1;
+    return findState(false, (bbsc_index_t)(after + 1));
+}
+
+// Finds the previous true state before an index
+bbsc_sindex_t BBStateControl::prevTrue(bbsc_sindex_t before) const {
+    STAT_OP(OP_FIND);
+    if (!array || before <= 0) return -1;
+    bbsc_index_t last = (bbsc_sindex_t)def_size < before ? def_size - 1 : (bbsc_index_t)(before - 1);
+    bbsc_index_t i = last >> BBSC_WORD_SHIFT;
+    bbsc_word_t w = array[i] & ((bbsc_word_t)~(bbsc_word_t)0 >> (BBSC_WORD_MASK - (last & BBSC_WORD_MASK)));
+    if (!w) {
+        if (i == 0) return -1;
+        i = prevTrueWord(i - 1);
+        if (i >= word_size) return -1;
+        w = array[i];
+    }
+    return (i << BBSC_WORD_SHIFT) + msbWord(w);
+}
+
+// Finds the next true state after an index, wrapping around
+bbsc_sindex_t BBStateControl::nextTrueCyclic(bbsc_sindex_t after) const {
+    bbsc_sindex_t index = nextTrue(after);
+    return index >= 0 ? index : getFirstTrueIndex();
 }
 
 // Returns serialization size
-uint8_t BBStateControl::serializeStatesSize() const {
-    return def_size + 1; // Chars for '0'/'1' + null
+size_t BBStateControl::serializeStatesSize() const {
+    return (size_t)def_size + 1; // Chars for '0'/'1' + null
 }
 
 // Sets a range of states
-void BBStateControl::setRangeStates(uint8_t start, uint8_t end, bool state) {
+void BBStateControl::setRangeStates(bbsc_index_t start, bbsc_index_t end, bool state) {
+    STAT_OP(OP_BULK);
     if (!array || start >= def_size) return;
-    end = min(end, def_size - 1);
-    resetArray();
-    for (uint8_t i = start; i <= end; i++) {
-        setBit(i, state);
-        if (state && trueIndex == -1) trueIndex = i;
+    fillWords(0);
+    trueIndex = -1;
+    pendingExclusive = NO_PENDING;
+    if (state && clampRange(start, end)) {
+        writeRange(start, end, RANGE_SET);
+        trueIndex = start;
+    }
+    endChange();
+}
+
+// Combines the bitfield and the saved state for an iteration view
+bbsc_word_t BBStateControl::viewWord(uint8_t view, bbsc_index_t word) const {
+    bbsc_word_t now = array[word];
+    if (view == VIEW_TRUE) return now;
+    if (view == VIEW_DIRTY) return dirty[word];
+    bbsc_word_t prev = savedState[word];
+    if (view == VIEW_RISING) return now & ~prev;
+    if (view == VIEW_FALLING) return prev & ~now;
+    return now ^ prev;
+}
+
+// Checks if any state differs from the previous poll
+bool BBStateControl::hasChanges() const {
+    if (!array || !savedState) return false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if (array[i] != savedState[i]) return true;
+    }
+    return false;
+}
+
+// Sets the change notification callback
+void BBStateControl::setObserver(ChangeCallback callback, void* context) {
+    observer = callback;
+    observerContext = context;
+}
+
+// Allocates the dirty mask
+bool BBStateControl::enableDirtyTracking() {
+    if (dirty) return true;
+    if (!array || word_size == 0) return false;
+    dirty = new bbsc_word_t[word_size]();
+    BBSC_STAT(statsData.allocations++);
+    return dirty != nullptr;
+}
+
+// Frees the dirty mask
+void BBStateControl::disableDirtyTracking() {
+    delete[] dirty;
+    dirty = nullptr;
+}
+
+// Checks for changes since the last consumeDirty()
+bool BBStateControl::isDirty() const {
+    if (!dirty) return false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if (dirty[i]) return true;
+    }
+    return false;
+}
+
+// Clears the dirty mask
+void BBStateControl::consumeDirty() {
+    if (!dirty) return;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        dirty[i] = 0;
+    }
+}
+
+// Moves dirty indices into a buffer
+bbsc_index_t BBStateControl::consumeDirty(bbsc_index_t* out, bbsc_index_t cap) {
+    if (!dirty || !out) return 0;
+    bbsc_index_t pos = 0;
+    for (bbsc_index_t i = 0; i < word_size && pos < cap; i++) {
+        while (dirty[i] && pos < cap) {
+            out[pos++] = (i << BBSC_WORD_SHIFT) + ctzWord(dirty[i]);
+            dirty[i] &= (bbsc_word_t)(dirty[i] - 1); // Clear lowest dirty bit
+        }
+    }
+    return pos;
+}
+
+// Checks a range and clamps its end
+bool BBStateControl::clampRange(bbsc_index_t start, bbsc_index_t& end) const {
+    if (!array || start >= def_size || end < start) return false;
+    if (end >= def_size) end = def_size - 1;
+    return true;
+}
+
+// Writes a range one word at a time
+void BBStateControl::writeRange(bbsc_index_t start, bbsc_index_t end, uint8_t op) {
+    bbsc_index_t first = start >> BBSC_WORD_SHIFT;
+    bbsc_index_t last = end >> BBSC_WORD_SHIFT;
+    for (bbsc_index_t i = first; i <= last; i++) {
+        bbsc_word_t mask = rangeMask(i, first, last, start, end);
+        if (op == RANGE_SET) {
+            storeWord(i, array[i] | mask);
+        } else if (op == RANGE_CLEAR) {
+            storeWord(i, array[i] & ~mask);
+        } else {
+            storeWord(i, array[i] ^ mask);
+        }
     }
 }
 
+// Sets a range without touching other states
+void BBStateControl::setRange(bbsc_index_t start, bbsc_index_t end, bool state) {
+    if (!state) {
+        clearRange(start, end);
+        return;
+    }
+    if (!clampRange(start, end)) return;
+    STAT_OP(OP_BULK);
+    flushPendingExclusive(); // Apply deferred exclusive before setting
+    writeRange(start, end, RANGE_SET);
+    if (trueIndex == -1) trueIndex = start;
+    endChange();
+}
+
+// Clears a range without touching other states
+void BBStateControl::clearRange(bbsc_index_t start, bbsc_index_t end) {
+    STAT_OP(OP_BULK);
+    if (!clampRange(start, end)) return;
+    writeRange(start, end, RANGE_CLEAR);
+    revalidateTrueIndex();
+    endChange();
+}
+
+// Inverts a range without touching other states
+void BBStateControl::toggleRange(bbsc_index_t start, bbsc_index_t end) {
+    STAT_OP(OP_BULK);
+    if (!clampRange(start, end)) return;
+    flushPendingExclusive(); // Apply deferred exclusive before inverting
+    writeRange(start, end, RANGE_TOGGLE);
+    revalidateTrueIndex();
+    endChange();
+}
+
+// Checks for a true state in a range
+bool BBStateControl::testRangeAny(bbsc_index_t start, bbsc_index_t end) const {
+    if (!clampRange(start, end)) return false;
+    bbsc_index_t first = start >> BBSC_WORD_SHIFT;
+    bbsc_index_t last = end >> BBSC_WORD_SHIFT;
+    for (bbsc_index_t i = first; i <= last; i++) {
+        if (array[i] & rangeMask(i, first, last, start, end)) return true;
+    }
+    return false;
+}
+
+// Checks that a range holds only true states
+bool BBStateControl::testRangeAll(bbsc_index_t start, bbsc_index_t end) const {
+    if (!clampRange(start, end)) return false;
+    bbsc_index_t first = start >> BBSC_WORD_SHIFT;
+    bbsc_index_t last = end >> BBSC_WORD_SHIFT;
+    for (bbsc_index_t i = first; i <= last; i++) {
+        bbsc_word_t mask = rangeMask(i, first, last, start, end);
+        if ((array[i] & mask) != mask) return false;
+    }
+    return true;
+}
+
+// Counts the true states in a range
+bbsc_index_t BBStateControl::countRange(bbsc_index_t start, bbsc_index_t end) const {
+    STAT_OP(OP_COUNT);
+    if (!clampRange(start, end)) return 0;
+    bbsc_index_t first = start >> BBSC_WORD_SHIFT;
+    bbsc_index_t last = end >> BBSC_WORD_SHIFT;
+    BBSC_STAT(statsData.wordsScanned += last - first + 1);
+    bbsc_index_t count = 0;
+    for (bbsc_index_t i = first; i <= last; i++) {
+        count += popcountWord(array[i] & rangeMask(i, first, last, start, end));
+    }
+    return count;
+}
+
+// Declares a range of states as an exclusive group
+int8_t BBStateControl::defineGroup(bbsc_index_t start, bbsc_index_t end) {
+    if (!clampRange(start, end) || group_count >= MAX_GROUPS) return -1;
+    for (uint8_t i = 0; i < group_count; i++) {
+        if (start <= groups[i].end && groups[i].start <= end) return -1; // Overlap
+    }
+    StateGroup* grown = new StateGroup[group_count + 1];
+    BBSC_STAT(statsData.allocations++);
+    if (!grown) return -1;
+    for (uint8_t i = 0; i < group_count; i++) {
+        grown[i] = groups[i];
+    }
+    grown[group_count].start = start;
+    grown[group_count].end = end;
+    grown[group_count].active = -1;
+    delete[] groups;
+    groups = grown;
+    return (int8_t)group_count++;
+}
+
+// Removes all exclusive groups
+void BBStateControl::clearGroups() {
+    delete[] groups;
+    groups = nullptr;
+    group_count = 0;
+}
+
+// Finds the group holding a state
+int8_t BBStateControl::groupOf(bbsc_index_t index) const {
+    for (uint8_t i = 0; i < group_count; i++) {
+        if (index >= groups[i].start && index <= groups[i].end) return (int8_t)i;
+    }
+    return -1;
+}
+
+// Gets the active state of a group
+bbsc_sindex_t BBStateControl::getGroupActive(uint8_t group) const {
+    if (group >= group_count) return -1;
+    StateGroup& g = groups[group];
+    if (g.active >= 0 && getBit((bbsc_index_t)g.active)) return g.active; // Still valid
+    g.active = -1;
+    bbsc_index_t first = g.start >> BBSC_WORD_SHIFT;
+    bbsc_index_t last = g.end >> BBSC_WORD_SHIFT;
+    for (bbsc_index_t i = first; i <= last; i++) {
+        bbsc_word_t w = array[i] & rangeMask(i, first, last, g.start, g.end);
+        if (w) {
+            g.active = (i << BBSC_WORD_SHIFT) + ctzWord(w);
+            break;
+        }
+    }
+    return g.active;
+}
+
+// Clears every state of a group
+void BBStateControl::clearGroup(uint8_t group) {
+    if (group >= group_count) return;
+    writeRange(groups[group].start, groups[group].end, RANGE_CLEAR);
+    groups[group].active = -1;
+    revalidateTrueIndex();
+    endChange();
+}
+
 // Checks if any state is true
 bool BBStateControl::isAssignedIndex() const {
-    return getFirstTrueIndex() != -1;
+    return resolvedTrueIndex() != -1; // trueIndex is -1 exactly when no state is set
 }
 
 // Counts true states
-uint8_t BBStateControl::countTrueStates() const {
-    if (!array || byte_size == 0) return 0;
-    uint8_t count = 0;
-    for (uint8_t i = 0; i < def_size; i++) {
-        if (getBit(i)) count++;
+bbsc_index_t BBStateControl::countTrueStates() const {
+    STAT_OP(OP_COUNT);
+    if (!array || word_size == 0) return 0;
+    BBSC_STAT(statsData.wordsScanned += word_size);
+    bbsc_index_t count = 0;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        count += popcountWord(array[i]);
     }
     return count;
 }
 
 // Inverts all states
 void BBStateControl::invertStates() {
-    if (!array || byte_size == 0) return;
-    for (uint8_t i = 0; i < byte_size; i++) {
-        array[i] = ~array[i];
-    }
-    // Mask unused bits in the last byte
-    uint8_t bits_in_last = def_size & 0x07;
-    if (bits_in_last != 0) {
-        array[byte_size - 1] &= (1 << bits_in_last) - 1;
+    STAT_OP(OP_BULK);
+    if (!array || word_size == 0) return;
+    flushPendingExclusive(); // Apply deferred exclusive before inverting
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        bbsc_word_t valid = (i == word_size - 1) ? lastWordMask() : (bbsc_word_t)~(bbsc_word_t)0;
+        storeWord(i, (bbsc_word_t)~array[i] & valid); // Unused bits stay clear
     }
-    trueIndex = getFirstTrueIndex();
+    trueIndex = TRUE_INDEX_DIRTY; // Recomputed on next read
+    endChange();
 }
 
 // Validates single true state
 bool BBStateControl::validateSingleState() const {
-    return countTrueStates() == 1;
+    if (!array) return false;
+    bool found = false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        BBSC_STAT(statsData.wordsScanned++);
+        bbsc_word_t w = array[i];
+        if (!w) continue;
+        if (found || (w & (bbsc_word_t)(w - 1))) return false; // More than one bit set
+        found = true;
+    }
+    return found;
 }
 
 // Checks if an index is valid
-bool BBStateControl::isValidIndex(uint8_t index) const {
+bool BBStateControl::isValidIndex(bbsc_index_t index) const {
     return (array && index < def_size);
 }
 
 // Copies states from another object
 bool BBStateControl::copyStatesFrom(const BBStateControl& source) {
+    STAT_OP(OP_BULK);
     if (!array || !source.array || def_size != source.def_size) return false;
-    for (uint8_t i = 0; i < byte_size; i++) {
-        array[i] = source.array[i];
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, source.array[i]);
     }
-    trueIndex = source.trueIndex;
+    trueIndex = source.resolvedTrueIndex();
+    pendingExclusive = NO_PENDING;
+    endChange();
     return true;
 }
 
 // Serializes states to a string
-void BBStateControl::serializeStates(char* buffer, uint8_t bufSize) const {
-    if (!array || byte_size == 0 || !buffer || bufSize == 0) {
+void BBStateControl::serializeStates(char* buffer, size_t bufSize) const {
+    STAT_OP(OP_SERIALIZE);
+    if (!array || word_size == 0 || !buffer || bufSize == 0) {
         if (bufSize > 0) buffer[0] = '\0';
         return;
     }
-    uint8_t len = min(def_size, bufSize - 1);
-    for (uint8_t i = 0; i < len; i++) {
+    size_t len = min((size_t)def_size, bufSize - 1);
+    for (size_t i = 0; i < len; i++) {
         buffer[i] = getBit(i) ? '1' : '0';
     }
     buffer[len] = '\0';
 }
 
 // Clears all states except one
-void BBStateControl::clearOthers(uint8_t index) {
-    if (!array || byte_size == 0) return;
-    for (uint8_t i = 0; i < def_size; i++) {
-        if (i != index) setBit(i, false);
+void BBStateControl::clearOthers(bbsc_index_t index) {
+    if (!array || word_size == 0) return;
+    STAT_OP(OP_CLEAR_OTHERS);
+    BBSC_STAT(uint32_t started = statsClock());
+    bbsc_index_t keep = index >> BBSC_WORD_SHIFT;
+    bbsc_word_t bit = (bbsc_word_t)1 << (index & BBSC_WORD_MASK);
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        BBSC_STAT(if (!(array[i] & (i == keep ? ~bit : ~(bbsc_word_t)0))) statsData.clearOthersIdle++);
+        storeWord(i, i == keep ? (bbsc_word_t)(array[i] & bit) : 0); // Single masked write per word
     }
-}
\ No newline at end of file
+    BBSC_STAT(statsData.clearOthersTicks += statsClock() - started);
+}
+
+// Clears the other states of the group, or of the whole set (at commit() inside a batch)
+void BBStateControl::applyExclusive(bbsc_index_t index) {
+    int8_t group = groupOf(index);
+    if (group >= 0) {
+        const StateGroup& g = groups[group];
+        bbsc_index_t first = g.start >> BBSC_WORD_SHIFT;
+        bbsc_index_t last = g.end >> BBSC_WORD_SHIFT;
+        bbsc_index_t keep = index >> BBSC_WORD_SHIFT;
+        for (bbsc_index_t i = first; i <= last; i++) {
+            bbsc_word_t mask = rangeMask(i, first, last, g.start, g.end);
+            if (i == keep) mask &= ~((bbsc_word_t)1 << (index & BBSC_WORD_MASK));
+            storeWord(i, array[i] & ~mask); // Only this group's bits are cleared
+        }
+        return;
+    }
+    if (batchDepth > 0) {
+        pendingExclusive = index; // Replaces any earlier request, which would clear the same states
+        pendingKeepCount = 0;
+    } else {
+        clearOthers(index);
+    }
+}
+
+// Remembers a state set to true as its group's active state
+void BBStateControl::noteGroupActive(bbsc_index_t index) {
+    if (group_count == 0) return;
+    int8_t group = groupOf(index);
+    if (group >= 0) groups[group].active = index;
+}
+
+// Marks trueIndex for recomputation after a bulk write
+void BBStateControl::invalidateTrueIndex() {
+    trueIndex = TRUE_INDEX_DIRTY;
+    pendingExclusive = NO_PENDING;
+}
+
+// Applies a deferred exclusive request now, keeping the states set after it
+void BBStateControl::flushPendingExclusive() {
+    if (pendingExclusive == NO_PENDING) return;
+    if (pendingKeepCount == 0) {
+        clearOthers(pendingExclusive);
+    } else if (array && word_size > 0) {
+        STAT_OP(OP_CLEAR_OTHERS);
+        for (bbsc_index_t i = 0; i < word_size; i++) {
+            bbsc_word_t keep = 0;
+            for (uint8_t k = 0; k <= pendingKeepCount; k++) {
+                bbsc_index_t index = k < pendingKeepCount ? pendingKeep[k] : pendingExclusive;
+                if ((index >> BBSC_WORD_SHIFT) == i) keep |= (bbsc_word_t)1 << (index & BBSC_WORD_MASK);
+            }
+            storeWord(i, array[i] & keep); // Single masked write per word
+        }
+    }
+    pendingExclusive = NO_PENDING;
+    pendingKeepCount = 0;
+}
+
+// Checks if commit() will clear a state
+bool BBStateControl::pendingClears(bbsc_index_t index) const {
+    if (pendingExclusive == NO_PENDING || index == pendingExclusive) return false;
+    for (uint8_t k = 0; k < pendingKeepCount; k++) {
+        if (pendingKeep[k] == index) return false;
+    }
+    return true;
+}
+
+// Records a state about to be set after a deferred exclusive request
+void BBStateControl::keepAfterPending(bbsc_index_t index) {
+    if (!pendingClears(index)) return;
+    if (pendingKeepCount == PENDING_KEEP) {
+        flushPendingExclusive(); // Record full: clear now, before the state is set
+        return;
+    }
+    pendingKeep[pendingKeepCount++] = index;
+}
+
+// Keeps trueIndex only if its state is still set
+void BBStateControl::revalidateTrueIndex() {
+    if (trueIndex == TRUE_INDEX_DIRTY) return;
+    if (trueIndex < 0 || !getBit((bbsc_index_t)trueIndex)) trueIndex = TRUE_INDEX_DIRTY;
+}
+
+// Returns trueIndex, recomputing it if it was invalidated
+bbsc_sindex_t BBStateControl::resolvedTrueIndex() const {
+    if (trueIndex == TRUE_INDEX_DIRTY) {
+        BBSC_STAT(statsData.rescans++);
+        BBSC_STAT(uint32_t started = statsClock());
+        trueIndex = getFirstTrueIndex();
+        BBSC_STAT(statsData.rescanTicks += statsClock() - started);
+    }
+    return trueIndex;
+}
+
+// Starts a batch of updates
+void BBStateControl::beginBatch() {
+    if (batchDepth < 0xFF) batchDepth++;
+}
+
+// Ends a batch and applies deferred work
+void BBStateControl::commit() {
+    if (batchDepth == 0 || --batchDepth > 0) return;
+    if (pendingExclusive != NO_PENDING) {
+        flushPendingExclusive();
+        revalidateTrueIndex();
+    }
+    endChange(); // One notification for the whole batch
+}
+
+// Reads one byte of the bitfield
+uint8_t BBStateControl::getByte(bbsc_index_t index) const {
+    return (uint8_t)(array[index / WORD_BYTES] >> ((index % WORD_BYTES) * 8));
+}
+
+// Builds one bitfield word from serialized bytes
+bbsc_word_t BBStateControl::packWord(const uint8_t* bytes, bbsc_index_t word, bool fromFlash) const {
+    bbsc_index_t count = stateBytes();
+    bbsc_word_t w = 0;
+    for (uint8_t b = 0; b < WORD_BYTES; b++) {
+        bbsc_index_t index = word * WORD_BYTES + b;
+        if (index >= count) break;
+        uint8_t value = fromFlash ? pgm_read_byte(&bytes[index]) : bytes[index];
+        w |= (bbsc_word_t)value << (b * 8);
+    }
+    return word == word_size - 1 ? (bbsc_word_t)(w & lastWordMask()) : w; // Unused bits stay clear
+}
+
+// Computes a CRC-8 with polynomial 0x07
+uint8_t BBStateControl::crc8(const uint8_t* data, size_t len, uint8_t crc) {
+    if (!data) return crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Returns binary serialization size
+size_t BBStateControl::serializeBinarySize(bool withCrc) const {
+    return 1 + 2 * (size_t)fieldWidth(def_size) + stateBytes() + (withCrc ? 1 : 0);
+}
+
+// Serializes states to a binary frame
+size_t BBStateControl::serializeBinary(uint8_t* out, size_t cap, bool withCrc) const {
+    STAT_OP(OP_SERIALIZE);
+    size_t len = serializeBinarySize(withCrc);
+    if (!array || !out || cap < len) return 0;
+    uint8_t width = fieldWidth(def_size);
+    bbsc_sindex_t index = resolvedTrueIndex();
+    out[0] = BINARY_VERSION | (widthCode(width) << FIELD_WIDTH_SHIFT) | (withCrc ? BINARY_FLAG_CRC : 0);
+    putField(out + 1, def_size, width);
+    putField(out + 1 + width, index < 0 ? noneField(width) : (uint32_t)index, width);
+    uint8_t* data = out + 1 + 2 * width;
+    bbsc_index_t bytes = stateBytes();
+    for (bbsc_index_t i = 0; i < bytes; i++) {
+        data[i] = getByte(i);
+    }
+    if (withCrc) out[len - 1] = crc8(out, len - 1);
+    return len;
+}
+
+// Loads states from a binary frame
+bool BBStateControl::deserializeBinary(const uint8_t* in, size_t len) {
+    STAT_OP(OP_SERIALIZE);
+    if (!array || !in || len < 1) return false;
+    uint8_t width = fieldWidth(def_size);
+    if ((in[0] & 0x0F) != BINARY_VERSION) return false;
+    if (((in[0] >> FIELD_WIDTH_SHIFT) & 0x03) != widthCode(width)) return false;
+    bool withCrc = (in[0] & BINARY_FLAG_CRC) != 0;
+    size_t expected = serializeBinarySize(withCrc);
+    if (len < expected || getField(in + 1, width) != def_size) return false;
+    if (withCrc && crc8(in, expected - 1) != in[expected - 1]) return false;
+
+    const uint8_t* data = in + 1 + 2 * width;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, packWord(data, i));
+    }
+
+    uint32_t index = getField(in + 1 + width, width); // Trusted only if that state is set
+    bool known = index != noneField(width) && index < def_size && getBit((bbsc_index_t)index);
+    trueIndex = known ? (bbsc_sindex_t)index : TRUE_INDEX_DIRTY;
+    pendingExclusive = NO_PENDING;
+    endChange();
+    return true;
+}
+
+// Returns hex serialization size
+size_t BBStateControl::serializeHexSize() const {
+    return (size_t)stateBytes() * 2 + 1; // Two chars per byte + null
+}
+
+// Serializes the bitfield to hexadecimal text
+void BBStateControl::serializeHex(char* buffer, size_t bufSize) const {
+    STAT_OP(OP_SERIALIZE);
+    if (!buffer || bufSize == 0) return;
+    size_t pos = 0;
+    bbsc_index_t bytes = array ? stateBytes() : 0;
+    for (bbsc_index_t i = 0; i < bytes && pos + 2 < bufSize; i++) {
+        uint8_t b = getByte(i);
+        buffer[pos++] = pgm_read_byte(&HEX_DIGITS[b >> 4]);
+        buffer[pos++] = pgm_read_byte(&HEX_DIGITS[b & 0x0F]);
+    }
+    buffer[pos] = '\0';
+}
+
+// Finds the next index from 'from' where the XOR of two bitfields equals 'diff' (all ones if none)
+static bbsc_index_t nextXorBit(const bbsc_word_t* a, const bbsc_word_t* b, bbsc_index_t words,
+                               bbsc_word_t lastMask, bbsc_index_t from, bool diff) {
+    for (bbsc_index_t i = from >> BBSC_WORD_SHIFT; i < words; i++) {
+        bbsc_word_t x = a[i] ^ b[i];
+        if (!diff) x = ~x;
+        if (i == words - 1) x &= lastMask;
+        if (i == (from >> BBSC_WORD_SHIFT)) x &= (bbsc_word_t)~(bbsc_word_t)0 << (from & BBSC_WORD_MASK);
+        if (x) return (i << BBSC_WORD_SHIFT) + ctzWord(x);
+    }
+    return (bbsc_index_t)~(bbsc_index_t)0;
+}
+
+// Encodes the states that differ from the saved state
+size_t BBStateControl::encodeDelta(uint8_t* out, size_t cap) const {
+    if (!savedState) return 0;
+    return encodeDeltaFrom(savedState, out, cap);
+}
+
+// Encodes the states that differ from another object
+size_t BBStateControl::encodeDelta(const BBStateControl& base, uint8_t* out, size_t cap) const {
+    if (!base.array || def_size != base.def_size) return 0;
+    return encodeDeltaFrom(base.array, out, cap);
+}
+
+// Encodes the difference against a baseline, picking the smallest form
+size_t BBStateControl::encodeDeltaFrom(const bbsc_word_t* base, uint8_t* out, size_t cap) const {
+    STAT_OP(OP_SERIALIZE);
+    uint8_t width = fieldWidth(def_size);
+    size_t header = 1 + 2 * (size_t)width; // Mode, size, entry count
+    if (!array || !out || cap < header) return 0;
+
+    // Count changed states and runs of changed states
+    bbsc_index_t changed = 0;
+    bbsc_index_t runs = 0;
+    bbsc_word_t carry = 0; // Last bit of the previous word
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        bbsc_word_t x = array[i] ^ base[i];
+        changed += popcountWord(x);
+        runs += popcountWord(x & (bbsc_word_t)~((bbsc_word_t)(x << 1) | carry)); // Run starts
+        carry = x >> (BBSC_WORD_BITS - 1);
+    }
+
+    uint8_t mode = DELTA_INDICES;
+    size_t body = (size_t)changed * width;
+    if ((size_t)runs * 2 * width < body) {
+        mode = DELTA_RUNS;
+        body = (size_t)runs * 2 * width;
+    }
+    if (stateBytes() < body) {
+        mode = DELTA_BITMAP;
+        body = stateBytes();
+    }
+    if (cap < header + body) return 0;
+
+    out[0] = mode | (widthCode(width) << FIELD_WIDTH_SHIFT);
+    putField(out + 1, def_size, width);
+    size_t pos = header;
+    bbsc_word_t last = lastWordMask();
+    if (mode == DELTA_BITMAP) {
+        putField(out + 1 + width, stateBytes(), width);
+        for (bbsc_index_t i = 0; i < word_size; i++) {
+            bbsc_word_t x = array[i] ^ base[i];
+            for (uint8_t b = 0; b < WORD_BYTES && pos < header + body; b++) {
+                out[pos++] = (uint8_t)(x >> (b * 8));
+            }
+        }
+    } else if (mode == DELTA_RUNS) {
+        putField(out + 1 + width, runs, width);
+        bbsc_index_t index = nextXorBit(array, base, word_size, last, 0, true);
+        while (index < def_size) {
+            bbsc_index_t end = nextXorBit(array, base, word_size, last, index, false);
+            if (end > def_size) end = def_size;
+            putField(out + pos, index, width);
+            putField(out + pos + width, end - index, width);
+            pos += 2 * width;
+            if (end >= def_size) break;
+            index = nextXorBit(array, base, word_size, last, end, true);
+        }
+    } else {
+        putField(out + 1 + width, changed, width);
+        bbsc_index_t index = nextXorBit(array, base, word_size, last, 0, true);
+        while (index < def_size) {
+            putField(out + pos, index, width);
+            pos += width;
+            if (index + 1 >= def_size) break;
+            index = nextXorBit(array, base, word_size, last, index + 1, true);
+        }
+    }
+    return pos;
+}
+
+// Applies a delta by toggling the listed states
+bool BBStateControl::applyDelta(const uint8_t* in, size_t len) {
+    STAT_OP(OP_SERIALIZE);
+    if (!array) return false;
+    int32_t entries = checkDelta(in, len);
+    if (entries < 0) return false;
+    flushPendingExclusive(); // Apply deferred exclusive before toggling
+    uint8_t width = fieldWidth(def_size);
+    uint8_t mode = in[0] & 0x0F;
+    const uint8_t* data = in + 1 + 2 * (size_t)width;
+
+    if (mode == DELTA_BITMAP) {
+        for (bbsc_index_t i = 0; i < word_size; i++) {
+            storeWord(i, array[i] ^ packWord(data, i));
+        }
+    } else if (mode == DELTA_RUNS) {
+        for (int32_t i = 0; i < entries; i++) {
+            bbsc_index_t start = getField(data + 2 * i * width, width);
+            bbsc_index_t count = getField(data + (2 * i + 1) * width, width);
+            if (count) writeRange(start, start + count - 1, RANGE_TOGGLE);
+        }
+    } else {
+        for (int32_t i = 0; i < entries; i++) {
+            bbsc_index_t j = getField(data + i * width, width);
+            bbsc_index_t word = j >> BBSC_WORD_SHIFT;
+            storeWord(word, array[word] ^ ((bbsc_word_t)1 << (j & BBSC_WORD_MASK)));
+        }
+    }
+    invalidateTrueIndex();
+    endChange();
+    return true;
+}
+
+// Applies a delta to the saved state only
+bool BBStateControl::applyDeltaToSaved(const uint8_t* in, size_t len, bbsc_sindex_t index) {
+    if (!savedState) return false;
+    int32_t entries = checkDelta(in, len);
+    if (entries < 0) return false;
+    uint8_t width = fieldWidth(def_size);
+    uint8_t mode = in[0] & 0x0F;
+    const uint8_t* data = in + 1 + 2 * (size_t)width;
+
+    if (mode == DELTA_BITMAP) {
+        for (bbsc_index_t i = 0; i < word_size; i++) {
+            savedState[i] ^= packWord(data, i);
+        }
+    } else if (mode == DELTA_RUNS) {
+        for (int32_t i = 0; i < entries; i++) {
+            bbsc_index_t start = getField(data + 2 * i * width, width);
+            bbsc_index_t count = getField(data + (2 * i + 1) * width, width);
+            if (!count) continue;
+            bbsc_index_t end = start + count - 1;
+            bbsc_index_t first = start >> BBSC_WORD_SHIFT;
+            bbsc_index_t last = end >> BBSC_WORD_SHIFT;
+            for (bbsc_index_t w = first; w <= last; w++) {
+                savedState[w] ^= rangeMask(w, first, last, start, end);
+            }
+        }
+    } else {
+        for (int32_t i = 0; i < entries; i++) {
+            bbsc_index_t j = getField(data + i * width, width);
+            savedState[j >> BBSC_WORD_SHIFT] ^= (bbsc_word_t)1 << (j & BBSC_WORD_MASK);
+        }
+    }
+    savedTrueIndex = index;
+    return true;
+}
+
+// Validates a delta before any state is touched
+int32_t BBStateControl::checkDelta(const uint8_t* in, size_t len) const {
+    uint8_t width = fieldWidth(def_size);
+    size_t header = 1 + 2 * (size_t)width;
+    if (!in || len < header) return -1;
+    uint8_t mode = in[0] & 0x0F;
+    if (((in[0] >> FIELD_WIDTH_SHIFT) & 0x03) != widthCode(width)) return -1;
+    if (getField(in + 1, width) != def_size) return -1;
+    uint32_t entries = getField(in + 1 + width, width);
+    size_t body = mode == DELTA_BITMAP ? entries : (size_t)entries * width * (mode == DELTA_RUNS ? 2 : 1);
+    if (mode > DELTA_BITMAP || len < header + body) return -1;
+    if (mode == DELTA_BITMAP && entries != stateBytes()) return -1;
+    const uint8_t* data = in + header;
+
+    if (mode == DELTA_INDICES) {
+        for (uint32_t i = 0; i < entries; i++) {
+            if (getField(data + i * width, width) >= def_size) return -1;
+        }
+    } else if (mode == DELTA_RUNS) {
+        for (uint32_t i = 0; i < entries; i++) {
+            uint32_t start = getField(data + 2 * i * width, width);
+            uint32_t count = getField(data + (2 * i + 1) * width, width);
+            if (start > def_size || count > def_size - start) return -1;
+        }
+    }
+    return (int32_t)entries;
+}
+
+// Checks if two objects can be combined word by word
+bool BBStateControl::sameShape(const BBStateControl& other) const {
+    return array && other.array && def_size == other.def_size;
+}
+
+// Allocates and fills the summary bitmap
+bool BBStateControl::enableSummary() {
+    if (summary) return true;
+    if (!array || word_size == 0) return false;
+    summary = new bbsc_word_t[2 * summaryWords()];
+    BBSC_STAT(statsData.allocations++);
+    if (!summary) return false;
+    rebuildSummary();
+    return true;
+}
+
+// Frees the summary bitmap
+void BBStateControl::disableSummary() {
+    delete[] summary;
+    summary = nullptr;
+}
+
+// Updates the non-empty and non-full bits of one word
+void BBStateControl::updateSummary(bbsc_index_t word) {
+    bbsc_word_t* nonEmpty = summary + (word >> BBSC_WORD_SHIFT);
+    bbsc_word_t* nonFull = nonEmpty + summaryWords();
+    bbsc_word_t bit = (bbsc_word_t)1 << (word & BBSC_WORD_MASK);
+    bbsc_word_t full = (word == word_size - 1) ? lastWordMask() : (bbsc_word_t)~(bbsc_word_t)0;
+    if (array[word]) *nonEmpty |= bit; else *nonEmpty &= ~bit;
+    if (array[word] != full) *nonFull |= bit; else *nonFull &= ~bit;
+}
+
+// Recomputes the summary from the bitfield
+void BBStateControl::rebuildSummary() {
+    if (!summary) return;
+    bbsc_index_t marks = summaryWords();
+    for (bbsc_index_t i = 0; i < 2 * marks; i++) {
+        summary[i] = 0;
+    }
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        updateSummary(i);
+    }
+}
+
+// Allocates the rank table
+bool BBStateControl::enableRankIndex() {
+    if (rankTable) return true;
+    if (!array || word_size == 0) return false;
+    rankTable = new bbsc_index_t[word_size];
+    BBSC_STAT(statsData.allocations++);
+    if (!rankTable) return false;
+    rankDirty = true;
+    return true;
+}
+
+// Frees the rank table
+void BBStateControl::disableRankIndex() {
+    delete[] rankTable;
+    rankTable = nullptr;
+}
+
+// Recomputes the true states before each word
+void BBStateControl::refreshRankTable() const {
+    if (!rankTable || !rankDirty) return;
+    bbsc_index_t total = 0;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        rankTable[i] = total;
+        total += popcountWord(array[i]);
+    }
+    rankDirty = false;
+}
+
+// Counts the true states before an index
+bbsc_index_t BBStateControl::rank(bbsc_index_t index) const {
+    if (!array) return 0;
+    if (index >= def_size) return countTrueStates();
+    STAT_OP(OP_COUNT);
+    bbsc_index_t word = index >> BBSC_WORD_SHIFT;
+    bbsc_word_t below = ((bbsc_word_t)1 << (index & BBSC_WORD_MASK)) - 1;
+    bbsc_index_t count = popcountWord(array[word] & below);
+    if (rankTable) {
+        refreshRankTable();
+        return rankTable[word] + count;
+    }
+    BBSC_STAT(statsData.wordsScanned += word);
+    for (bbsc_index_t i = 0; i < word; i++) {
+        count += popcountWord(array[i]);
+    }
+    return count;
+}
+
+// Finds the k-th true state
+bbsc_sindex_t BBStateControl::select(bbsc_index_t k) const {
+    STAT_OP(OP_COUNT);
+    if (!array || word_size == 0) return -1;
+    bbsc_index_t word = 0;
+    if (rankTable) {
+        refreshRankTable();
+        bbsc_index_t lo = 0;
+        bbsc_index_t hi = word_size - 1;
+        while (lo < hi) { // Last word with rankTable[word] <= k
+            bbsc_index_t mid = lo + ((hi - lo + 1) >> 1);
+            if (rankTable[mid] <= k) lo = mid; else hi = mid - 1;
+        }
+        word = lo;
+        k -= rankTable[word];
+    } else {
+        for (; word < word_size; word++) {
+            BBSC_STAT(statsData.wordsScanned++);
+            uint8_t count = popcountWord(array[word]);
+            if (k < count) break;
+            k -= count;
+        }
+        if (word >= word_size) return -1;
+    }
+    bbsc_word_t w = array[word];
+    if (k >= popcountWord(w)) return -1;
+    for (; k > 0; k--) {
+        w &= (bbsc_word_t)(w - 1); // Drop the lower true states
+    }
+    return (word << BBSC_WORD_SHIFT) + ctzWord(w);
+}
+
+// Finds the next word holding a true (withTrue) or false state
+bbsc_index_t BBStateControl::nextWord(bbsc_index_t from, bool withTrue) const {
+    if (from >= word_size) return word_size;
+    if (summary) {
+        bbsc_index_t marks = summaryWords();
+        const bbsc_word_t* map = withTrue ? summary : summary + marks;
+        bbsc_index_t first = from >> BBSC_WORD_SHIFT;
+        for (bbsc_index_t m = first; m < marks; m++) {
+            BBSC_STAT(statsData.wordsScanned++);
+            bbsc_word_t w = map[m];
+            if (m == first) w &= (bbsc_word_t)~(bbsc_word_t)0 << (from & BBSC_WORD_MASK);
+            if (w) return (m << BBSC_WORD_SHIFT) + ctzWord(w);
+        }
+        return word_size;
+    }
+    for (bbsc_index_t i = from; i < word_size; i++) {
+        BBSC_STAT(statsData.wordsScanned++);
+        bbsc_word_t full = (i == word_size - 1) ? lastWordMask() : (bbsc_word_t)~(bbsc_word_t)0;
+        if (withTrue ? array[i] != 0 : array[i] != full) return i;
+    }
+    return word_size;
+}
+
+// Finds the previous word holding a true state
+bbsc_index_t BBStateControl::prevTrueWord(bbsc_index_t from) const {
+    if (from >= word_size) from = word_size - 1;
+    if (summary) {
+        bbsc_index_t m = from >> BBSC_WORD_SHIFT;
+        bbsc_word_t w = summary[m] & ((bbsc_word_t)~(bbsc_word_t)0 >> (BBSC_WORD_MASK - (from & BBSC_WORD_MASK)));
+        for (;;) {
+            BBSC_STAT(statsData.wordsScanned++);
+            if (w) return (m << BBSC_WORD_SHIFT) + msbWord(w);
+            if (m == 0) return word_size;
+            w = summary[--m];
+        }
+    }
+    for (bbsc_index_t i = from + 1; i-- > 0;) {
+        BBSC_STAT(statsData.wordsScanned++);
+        if (array[i]) return i;
+    }
+    return word_size;
+}
+
+// Intersects with another object
+bool BBStateControl::andWith(const BBStateControl& other) {
+    STAT_OP(OP_BULK);
+    if (!sameShape(other)) return false;
+    flushPendingExclusive();
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, array[i] & other.array[i]);
+    }
+    revalidateTrueIndex();
+    endChange();
+    return true;
+}
+
+// Unites with another object
+bool BBStateControl::orWith(const BBStateControl& other) {
+    STAT_OP(OP_BULK);
+    if (!sameShape(other)) return false;
+    flushPendingExclusive();
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, array[i] | other.array[i]);
+    }
+    revalidateTrueIndex();
+    endChange();
+    return true;
+}
+
+// Toggles the states set in another object
+bool BBStateControl::xorWith(const BBStateControl& other) {
+    STAT_OP(OP_BULK);
+    if (!sameShape(other)) return false;
+    flushPendingExclusive();
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, array[i] ^ other.array[i]);
+    }
+    revalidateTrueIndex();
+    endChange();
+    return true;
+}
+
+// Removes the states set in another object
+bool BBStateControl::andNotWith(const BBStateControl& other) {
+    STAT_OP(OP_BULK);
+    if (!sameShape(other)) return false;
+    flushPendingExclusive();
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, array[i] & ~other.array[i]);
+    }
+    revalidateTrueIndex();
+    endChange();
+    return true;
+}
+
+// Checks for a common true state
+bool BBStateControl::intersects(const BBStateControl& other) const {
+    if (!sameShape(other)) return false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if (array[i] & other.array[i]) return true;
+    }
+    return false;
+}
+
+// Checks if all true states are also true in another object
+bool BBStateControl::isSubsetOf(const BBStateControl& other) const {
+    if (!sameShape(other)) return false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if (array[i] & ~other.array[i]) return false;
+    }
+    return true;
+}
+
+// Checks if two objects hold the same states
+bool BBStateControl::equals(const BBStateControl& other) const {
+    if (!sameShape(other)) return false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if (array[i] != other.array[i]) return false;
+    }
+    return true;
+}
+
+// Checks the state count stored before the bytes of a flash mask
+bool BBStateControl::presetFits(const uint8_t* progmemMask) const {
+    uint32_t size = 0;
+    for (uint8_t b = 0; b < sizeof(bbsc_index_t); b++) {
+        size |= (uint32_t)pgm_read_byte(progmemMask + b) << (8 * b);
+    }
+    return size == def_size;
+}
+
+// Loads every state from a flash mask
+bool BBStateControl::loadPreset(const uint8_t* progmemMask) {
+    STAT_OP(OP_BULK);
+    if (!array || !progmemMask || !presetFits(progmemMask)) return false;
+    const uint8_t* bytes = progmemMask + sizeof(bbsc_index_t);
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        storeWord(i, packWord(bytes, i, true));
+    }
+    invalidateTrueIndex();
+    endChange();
+    return true;
+}
+
+// Compares every state with a flash mask
+bool BBStateControl::matchesPreset(const uint8_t* progmemMask) const {
+    STAT_OP(OP_FIND);
+    if (!array || !progmemMask || !presetFits(progmemMask)) return false;
+    const uint8_t* bytes = progmemMask + sizeof(bbsc_index_t);
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if (array[i] != packWord(bytes, i, true)) return false;
+    }
+    return true;
+}
+
+// Reverses the bit order of a byte
+static inline uint8_t reverseByte(uint8_t b) {
+    b = (uint8_t)((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = (uint8_t)((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    return (uint8_t)((b & 0xAA) >> 1 | (b & 0x55) << 1);
+}
+
+// Copies the bitfield bytes in a peripheral's order
+size_t BBStateControl::copyBytes(uint8_t* out, size_t len, bool msbFirst, bool lastByteFirst) const {
+    size_t count = stateBytes();
+    if (!array || !out || len < count) return 0;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t b = getByte(lastByteFirst ? count - 1 - i : i);
+        out[i] = msbFirst ? reverseByte(b) : b;
+    }
+    return count;
+}
+
+// Resynchronizes after a direct write to the bitfield
+void BBStateControl::dataChanged() {
+    STAT_OP(OP_BULK);
+    if (!array) return;
+    array[word_size - 1] &= lastWordMask(); // Unused bits stay clear
+    rankDirty = true;
+    rebuildSummary();
+    invalidateTrueIndex();
+    changeIndex = -1;
+    endChange();
+}
+
+#if BBSC_STATS
+// Gets the instrumentation counters
+const BBStateStats& BBStateControl::stats() {
+    return statsData;
+}
+
+// Zeroes the instrumentation counters
+void BBStateControl::resetStats() {
+    memset(&statsData, 0, sizeof(statsData));
+}
+
+// Writes the instrumentation counters as text
+size_t BBStateControl::formatStats(char* buffer, size_t bufSize) {
+    const BBStateStats& st = statsData;
+    int len = snprintf_P(buffer, bufSize,
+        PSTR("set=%lu toggle=%lu clearOthers=%lu find=%lu count=%lu bulk=%lu serialize=%lu "
+             "scanned=%lu written=%lu unchanged=%lu idleClears=%lu rescans=%lu allocs=%lu "
+             "rescanTicks=%lu clearOthersTicks=%lu"),
+        (unsigned long)st.ops[BBStateStats::OP_SET_STATE], (unsigned long)st.ops[BBStateStats::OP_TOGGLE],
+        (unsigned long)st.ops[BBStateStats::OP_CLEAR_OTHERS], (unsigned long)st.ops[BBStateStats::OP_FIND],
+        (unsigned long)st.ops[BBStateStats::OP_COUNT], (unsigned long)st.ops[BBStateStats::OP_BULK],
+        (unsigned long)st.ops[BBStateStats::OP_SERIALIZE], (unsigned long)st.wordsScanned,
+        (unsigned long)st.wordsWritten, (unsigned long)st.wordsUnchanged, (unsigned long)st.clearOthersIdle,
+        (unsigned long)st.rescans, (unsigned long)st.allocations, (unsigned long)st.rescanTicks,
+        (unsigned long)st.clearOthersTicks);
+    return len > 0 ? (size_t)len : 0;
+}
+
+// Reads the clock used by the tick counters
+uint32_t BBStateControl::statsClock() {
+#if defined(ESP32) || defined(ESP8266)
+    return ESP.getCycleCount();
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    volatile uint32_t* ctrl = (volatile uint32_t*)0xE0001000;  // DWT_CTRL
+    if (!(*ctrl & 1)) {
+        *(volatile uint32_t*)0xE000EDFC |= (1UL << 24);        // DEMCR.TRCENA
+        *ctrl |= 1;                                            // CYCCNTENA
+    }
+    return *(volatile uint32_t*)0xE0001004;                    // DWT_CYCCNT
+#else
+    return (uint32_t)micros();
+#endif
+}
+#endif
@@ -10,49 +10,288 @@
 #ifndef BIT_BASED_STATE_CONTROL_H
 #define BIT_BASED_STATE_CONTROL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * @brief Native word used by the bitfield kernels.
+ *
+ * 8-bit AVR keeps byte storage and plain byte loops. Other targets (ESP32, SAMD,
+ * RP2040, ...) store the bitfield in 32-bit words and use popcount and
+ * count-trailing-zeros builtins. Define BBSC_WORD_BITS as 8 to force byte storage.
+ * State i is bit (i % BBSC_WORD_BITS) of word (i / BBSC_WORD_BITS); on
+ * little-endian targets this is the same memory layout as byte storage.
+ */
+#ifndef BBSC_WORD_BITS
+#if defined(__AVR__)
+#define BBSC_WORD_BITS 8
+#else
+#define BBSC_WORD_BITS 32
+#endif
+#endif
+
+#if BBSC_WORD_BITS == 8
+typedef uint8_t bbsc_word_t;
+#define BBSC_WORD_SHIFT 3
+#elif BBSC_WORD_BITS == 32
+typedef uint32_t bbsc_word_t;
+#define BBSC_WORD_SHIFT 5
+#else
+#error "BBSC_WORD_BITS must be 8 or 32"
+#endif
+
+#define BBSC_WORD_MASK (BBSC_WORD_BITS - 1)
+#define BBSC_WORDS_FOR(n) (((n) + BBSC_WORD_MASK) >> BBSC_WORD_SHIFT)  ///< Words needed for n states.
+
+/**
+ * @brief Integer type used for state indices and counts.
+ *
+ * With 8-bit indices an object holds up to 254 states and every index costs a
+ * single byte, which is what AVR builds default to. Other targets default to
+ * 16-bit indices (up to 65534 states). Define BBSC_INDEX_BITS as 8, 16 or 32
+ * to choose explicitly. bbsc_sindex_t is the signed type returned by lookups,
+ * where -1 means "not found".
+ */
+#ifndef BBSC_INDEX_BITS
+#if defined(__AVR__)
+#define BBSC_INDEX_BITS 8
+#else
+#define BBSC_INDEX_BITS 16
+#endif
+#endif
+
+#if BBSC_INDEX_BITS == 8
+typedef uint8_t bbsc_index_t;
+typedef int16_t bbsc_sindex_t;
+#define BBSC_MAX_STATES 254UL
+#elif BBSC_INDEX_BITS == 16
+typedef uint16_t bbsc_index_t;
+typedef int32_t bbsc_sindex_t;
+#define BBSC_MAX_STATES 65534UL
+#elif BBSC_INDEX_BITS == 32
+typedef uint32_t bbsc_index_t;
+typedef int32_t bbsc_sindex_t;
+#define BBSC_MAX_STATES 0x7FFFFFFEUL
+#else
+#error "BBSC_INDEX_BITS must be 8, 16 or 32"
+#endif
+
+/**
+ * @brief Define BBSC_STATS as 1 to count operations, scanned words, trueIndex
+ * rescans and allocations for all objects (see BBStateControl::stats()).
+ *
+ * When disabled (the default), BBSC_STAT() expands to nothing and neither the
+ * counters nor the functions reading them exist.
+ */
+#ifndef BBSC_STATS
+#define BBSC_STATS 0
+#endif
+
+#if BBSC_STATS
+#define BBSC_STAT(statement) statement
+#else
+#define BBSC_STAT(statement)
+#endif
+
+#if BBSC_STATS
+/**
+ * @struct BBStateStats
+ * @brief Instrumentation counters shared by every BBStateControl (BBSC_STATS builds only).
+ */
+struct BBStateStats {
+    static const uint8_t OP_SET_STATE = 0;     ///< setState() calls.
+    static const uint8_t OP_TOGGLE = 1;        ///< toggleState() calls.
+    static const uint8_t OP_CLEAR_OTHERS = 2;  ///< Whole-set exclusive clears.
+    static const uint8_t OP_FIND = 3;          ///< Searches (getFirstTrueIndex(), findState(), prevTrue(), ...).
+    static const uint8_t OP_COUNT = 4;         ///< Counts (countTrueStates(), countRange(), rank(), select()).
+    static const uint8_t OP_BULK = 5;          ///< Whole-set and range writes.
+    static const uint8_t OP_SERIALIZE = 6;     ///< Serialization, deltas and their decoding.
+    static const uint8_t OP_TYPES = 7;         ///< Number of operation types.
+
+    uint32_t ops[OP_TYPES];     ///< Calls per operation type.
+    uint32_t wordsScanned;      ///< Bitfield words read by searches and counts.
+    uint32_t wordsWritten;      ///< Word stores that changed the bitfield.
+    uint32_t wordsUnchanged;    ///< Word stores that found the word already as wanted.
+    uint32_t clearOthersIdle;   ///< Words clearOthers() visited that were already clear.
+    uint32_t rescans;           ///< trueIndex recomputations (getFirstTrueIndex() scans).
+    uint32_t allocations;       ///< Heap allocations made by BBStateControl.
+    uint32_t rescanTicks;       ///< Clock ticks spent in trueIndex recomputations.
+    uint32_t clearOthersTicks;  ///< Clock ticks spent in clearOthers().
+};
+#endif
+
+class BBStateArena;
+
 /**
  * @class BBStateControl
  * @brief Manages a set of boolean states using a bitfield for memory efficiency.
  *
  * This class provides methods to manipulate boolean states stored as bits in a
  * dynamically allocated array, optimized for microcontrollers. It supports operations
- * like setting, toggling, saving, and restoring states, with a maximum of 254 states.
+ * like setting, toggling, saving, and restoring states, with up to BBSC_MAX_STATES states.
  */
 class BBStateControl {
 public:
+    /**
+     * @class TrueIterator
+     * @brief Forward iterator over the indices of true states (or of edges), in ascending order.
+     *
+     * Reads the bitfield directly and skips whole zero words (using the summary
+     * bitmap when enabled); no allocation.
+     * Modifying the object while iterating invalidates the iterator.
+     */
+    class TrueIterator {
+    public:
+        bbsc_index_t operator*() const { return index; }
+        TrueIterator& operator++() { bits &= (bbsc_word_t)(bits - 1); settle(); return *this; }
+        bool operator==(const TrueIterator& other) const { return word == other.word && bits == other.bits; }
+        bool operator!=(const TrueIterator& other) const { return !(*this == other); }
+
+    private:
+        friend class BBStateControl;
+        TrueIterator(const BBStateControl* source, bool atEnd, uint8_t view = VIEW_TRUE);
+
+        /**
+         * @brief Moves to the next non-zero word if needed and updates the index.
+         */
+        void settle();
+
+        const BBStateControl* owner;  ///< Object being iterated.
+        bbsc_index_t word;                 ///< Current word (owner->word_size at end).
+        bbsc_word_t bits;             ///< Bits of the current word not yet visited.
+        bbsc_index_t index;                ///< Current state index.
+        uint8_t view;                 ///< Bits visited (VIEW_TRUE, VIEW_RISING, ...).
+    };
+
+    /**
+     * @struct TrueRange
+     * @brief Range of true state (or edge) indices for use in range-based for loops.
+     */
+    struct TrueRange {
+        const BBStateControl* owner;  ///< Object being iterated.
+        uint8_t view;                 ///< Bits visited (VIEW_TRUE, VIEW_RISING, ...).
+        TrueIterator begin() const { return TrueIterator(owner, false, view); }
+        TrueIterator end() const { return TrueIterator(owner, true, view); }
+    };
+
+    /**
+     * @class BatchUpdate
+     * @brief Scope guard calling beginBatch() on construction and commit() on destruction.
+     */
+    class BatchUpdate {
+    public:
+        explicit BatchUpdate(BBStateControl& owner) : target(owner) { target.beginBatch(); }
+        ~BatchUpdate() { target.commit(); }
+        BatchUpdate(const BatchUpdate&) = delete;
+        BatchUpdate& operator=(const BatchUpdate&) = delete;
+
+    private:
+        BBStateControl& target;  ///< Object being updated.
+    };
+
+    /**
+     * @brief Callback type for forEachTrue().
+     * @param index Index of a true state.
+     * @param context User pointer passed to forEachTrue().
+     */
+    typedef void (*TrueCallback)(bbsc_index_t index, void* context);
+
+    /**
+     * @brief Callback type for setObserver().
+     * @param index Index of the state that changed, or -1 if several states changed.
+     * @param context User pointer passed to setObserver().
+     */
+    typedef void (*ChangeCallback)(bbsc_sindex_t index, void* context);
+
     /**
      * @brief Initializes the object with a specified number of states.
-     * @param size Number of states to manage (max 254).
+     * @param size Number of states to manage (max BBSC_MAX_STATES).
      */
-    explicit BBStateControl(uint8_t size);
+    explicit BBStateControl(bbsc_index_t size);
+
+    /**
+     * @brief Initializes the object, optionally without the saved state bitfield.
+     * @param size Number of states to manage (max BBSC_MAX_STATES).
+     * @param withSavedState False to skip allocating savedState (saveState() does nothing).
+     */
+    BBStateControl(bbsc_index_t size, bool withSavedState);
+
+    /**
+     * @brief Initializes the object on storage taken from an arena (no heap allocation).
+     * @param size Number of states to manage (max BBSC_MAX_STATES).
+     * @param arena Arena providing the bitfield and, if requested, the saved state.
+     * @param withSavedState True to reserve the saved state bitfield.
+     */
+    BBStateControl(bbsc_index_t size, BBStateArena& arena, bool withSavedState = true);
+
+    /**
+     * @brief Initializes the object on storage owned by the caller (no heap allocation).
+     *
+     * Both buffers are cleared. Use it to keep the states in a DMA-able buffer
+     * or an I/O expander shadow register; data() then exposes the bytes.
+     *
+     * @param size Number of states to manage (max BBSC_MAX_STATES).
+     * @param storage Bitfield storage of at least BBSC_WORDS_FOR(size) words.
+     * @param saved Saved state storage of the same size, or nullptr for none.
+     */
+    BBStateControl(bbsc_index_t size, bbsc_word_t* storage, bbsc_word_t* saved);
 
     /**
      * @brief Frees allocated memory.
      */
     ~BBStateControl();
 
+    /**
+     * @brief Takes over the storage of another object without allocating.
+     *
+     * The source is left with zero states. Storage inside a BBStateControlT
+     * cannot follow the object: moving from one leaves this object empty and
+     * the source unchanged.
+     *
+     * @param other Object to move from (outside a batch).
+     */
+    BBStateControl(BBStateControl&& other);
+
+    /**
+     * @brief Frees this object's storage and takes over the storage of another.
+     *
+     * Does nothing if either object is a BBStateControlT.
+     *
+     * @param other Object to move from (outside a batch).
+     * @return This object.
+     */
+    BBStateControl& operator=(BBStateControl&& other);
+
+    BBStateControl(const BBStateControl&) = delete;             ///< Use copyStatesFrom().
+    BBStateControl& operator=(const BBStateControl&) = delete;  ///< Use copyStatesFrom().
+
+    /**
+     * @brief Exchanges the states, storage and settings of two objects in O(1).
+     * @param other Object to swap with (both outside a batch).
+     * @return False, with both objects unchanged, if either is a BBStateControlT.
+     */
+    bool swap(BBStateControl& other);
+
     /**
      * @brief Sets a state at the given index to true.
      * @param index Index of the state (0 to def_size-1).
-     * @param exclusive If true, clears all other states.
+     * @param exclusive If true, clears all other states (only its group if grouped).
      */
-    void setState(uint8_t index, bool exclusive = true);
+    void setState(bbsc_index_t index, bool exclusive = true);
 
     /**
      * @brief Sets a state at the given index to a specified value.
      * @param index Index of the state (0 to def_size-1).
      * @param state Value to set (true/false).
-     * @param exclusive If true, clears all other states.
+     * @param exclusive If true, clears all other states (only its group if grouped).
      */
-    void setState(uint8_t index, bool state, bool exclusive = true);
+    void setState(bbsc_index_t index, bool state, bool exclusive = true);
 
     /**
      * @brief Toggles the state at the given index.
      * @param index Index of the state (0 to def_size-1).
      */
-    void toggleState(uint8_t index);
+    void toggleState(bbsc_index_t index);
 
     /**
      * @brief Resets all states to false.
@@ -75,13 +314,13 @@ public:
      * @param index Index of the state (0 to def_size-1).
      * @return True if the state is active, false otherwise.
      */
-    bool getState(uint8_t index) const;
+    bool getState(bbsc_index_t index) const;
 
     /**
      * @brief Gets the index of the first true state.
      * @return Index of the first true state, or -1 if none.
      */
-    int8_t getFirstTrueIndex() const;
+    bbsc_sindex_t getFirstTrueIndex() const;
 
     /**
      * @brief Gets all indices of true states.
@@ -89,7 +328,39 @@ public:
      * @return Pointer to a dynamically allocated array of indices, or nullptr if none.
      * @note Caller must free the returned memory with delete[].
      */
+    bbsc_index_t* getAllTrueIndices(bbsc_index_t& count) const;
+
+#if BBSC_INDEX_BITS != 8
+    /**
+     * @brief Gets all indices of true states as bytes (for sketches written for 8-bit indices).
+     * @param count Reference to store the number of true states.
+     * @return Pointer to a dynamically allocated array of indices, or nullptr if none
+     *         or if a true index does not fit in a byte (count is then 0).
+     * @note Caller must free the returned memory with delete[].
+     */
     uint8_t* getAllTrueIndices(uint8_t& count) const;
+#endif
+
+    /**
+     * @brief Writes the indices of true states into a caller-provided buffer.
+     * @param out Buffer receiving the indices in ascending order.
+     * @param cap Capacity of the buffer.
+     * @return Number of indices written (at most cap).
+     */
+    bbsc_index_t getAllTrueIndices(bbsc_index_t* out, bbsc_index_t cap) const;
+
+    /**
+     * @brief Gets a range over the indices of true states.
+     * @return Range usable as `for (bbsc_index_t i : states.trueIndices())`.
+     */
+    TrueRange trueIndices() const { return TrueRange{this, VIEW_TRUE}; }
+
+    /**
+     * @brief Calls a function for each true state, in ascending order.
+     * @param callback Function to call with each index.
+     * @param context User pointer forwarded to the callback.
+     */
+    void forEachTrue(TrueCallback callback, void* context = nullptr) const;
 
     /**
      * @brief Writes the index of the current true state as a string.
@@ -98,26 +369,122 @@ public:
      */
     void getIndex(char* buffer, uint8_t bufSize) const;
 
+    /**
+     * @brief Gets the index of the current true state.
+     * @return Index of the last state set true (or the first true state once
+     *         recomputed), or -1 if none.
+     */
+    bbsc_sindex_t getTrueIndex() const;
+
     /**
      * @brief Finds the first state matching the given value.
      * @param state Value to search for (true/false).
      * @return Index of the first matching state, or -1 if not found.
      */
-    int8_t findState(bool state) const;
+    bbsc_sindex_t findState(bool state) const;
+
+    /**
+     * @brief Finds the first state matching the given value at or after a position.
+     * @param state Value to search for (true/false).
+     * @param start First index to consider.
+     * @return Index of the first matching state, or -1 if not found.
+     */
+    bbsc_sindex_t findState(bool state, bbsc_index_t start) const;
+
+    /**
+     * @brief Finds the next true state after a position.
+     * @param after Index to start after (-1 to start at index 0).
+     * @return Index of the next true state, or -1 if none.
+     */
+    bbsc_sindex_t nextTrue(bbsc_sindex_t after) const;
+
+    /**
+     * @brief Finds the next false state after a position.
+     * @param after Index to start after (-1 to start at index 0).
+     * @return Index of the next false state, or -1 if none.
+     */
+    bbsc_sindex_t nextFalse(bbsc_sindex_t after) const;
+
+    /**
+     * @brief Finds the closest true state before a position.
+     * @param before Index to start before (the state count to search from the end).
+     * @return Index of the previous true state, or -1 if none.
+     */
+    bbsc_sindex_t prevTrue(bbsc_sindex_t before) const;
+
+    /**
+     * @brief Finds the next true state after a position, wrapping to the start.
+     *
+     * Suited to round-robin polling: each call costs at most one pass over the
+     * words, skipping zero words.
+     *
+     * @param after Index to start after (-1 to start at index 0).
+     * @return Index of the next true state (may be after itself), or -1 if none.
+     */
+    bbsc_sindex_t nextTrueCyclic(bbsc_sindex_t after) const;
 
     /**
      * @brief Gets the size needed to serialize states.
      * @return Number of characters needed (includes null terminator).
      */
-    uint8_t serializeStatesSize() const;
+    size_t serializeStatesSize() const;
 
     /**
-     * @brief Sets a range of states to a given value.
+     * @brief Clears all states, then sets a range of states to a given value.
      * @param start Start index of the range (0 to def_size-1).
      * @param end End index of the range (0 to def_size-1).
      * @param state Value to set (true/false).
      */
-    void setRangeStates(uint8_t start, uint8_t end, bool state);
+    void setRangeStates(bbsc_index_t start, bbsc_index_t end, bool state);
+
+    /**
+     * @brief Sets a range of states to a given value, keeping the states outside it.
+     *
+     * Whole words are written at once, with masks for the partial first and last words.
+     *
+     * @param start Start index of the range.
+     * @param end End index of the range (inclusive, clamped to def_size-1).
+     * @param state Value to set (true/false).
+     */
+    void setRange(bbsc_index_t start, bbsc_index_t end, bool state);
+
+    /**
+     * @brief Sets a range of states to false, keeping the states outside it.
+     * @param start Start index of the range.
+     * @param end End index of the range (inclusive, clamped to def_size-1).
+     */
+    void clearRange(bbsc_index_t start, bbsc_index_t end);
+
+    /**
+     * @brief Inverts a range of states, keeping the states outside it.
+     * @param start Start index of the range.
+     * @param end End index of the range (inclusive, clamped to def_size-1).
+     */
+    void toggleRange(bbsc_index_t start, bbsc_index_t end);
+
+    /**
+     * @brief Checks if any state in a range is true.
+     * @param start Start index of the range.
+     * @param end End index of the range (inclusive, clamped to def_size-1).
+     * @return True if at least one state in the range is true.
+     */
+    bool testRangeAny(bbsc_index_t start, bbsc_index_t end) const;
+
+    /**
+     * @brief Checks if every state in a range is true.
+     * @param start Start index of the range.
+     * @param end End index of the range (inclusive, clamped to def_size-1).
+     * @return True if all states in the range are true, false if any is false or the range is empty.
+     */
+    bool testRangeAll(bbsc_index_t start, bbsc_index_t end) const;
+
+    /**
+     * @brief Counts the true states in a range.
+     * @param start Start index of the range.
+     * @param end End index of the range (inclusive, clamped to def_size-1).
+     * @return Number of true states in the range.
+     */
+    bbsc_index_t countRange(bbsc_index_t start, bbsc_index_t end) const;
 
     /**
      * @brief Checks if at least one state is true.
@@ -129,7 +496,7 @@ public:
      * @brief Counts the number of true states.
      * @return Number of active states.
      */
-    uint8_t countTrueStates() const;
+    bbsc_index_t countTrueStates() const;
 
     /**
      * @brief Inverts all states (true to false and vice versa).
@@ -149,12 +516,207 @@ public:
      */
     bool copyStatesFrom(const BBStateControl& source);
 
+    /**
+     * @brief Keeps only the states that are also true in another object (this &= other).
+     * @param other Object of the same size.
+     * @return True if applied, false if sizes mismatch.
+     */
+    bool andWith(const BBStateControl& other);
+
+    /**
+     * @brief Sets the states that are true in another object (this |= other).
+     * @param other Object of the same size.
+     * @return True if applied, false if sizes mismatch.
+     */
+    bool orWith(const BBStateControl& other);
+
+    /**
+     * @brief Toggles the states that are true in another object (this ^= other).
+     * @param other Object of the same size.
+     * @return True if applied, false if sizes mismatch.
+     */
+    bool xorWith(const BBStateControl& other);
+
+    /**
+     * @brief Clears the states that are true in another object (this &= ~other).
+     * @param other Object of the same size.
+     * @return True if applied, false if sizes mismatch.
+     */
+    bool andNotWith(const BBStateControl& other);
+
+    /**
+     * @brief Checks if at least one state is true in both objects.
+     * @param other Object of the same size.
+     * @return True if the sets intersect, false otherwise or if sizes mismatch.
+     */
+    bool intersects(const BBStateControl& other) const;
+
+    /**
+     * @brief Checks if every true state is also true in another object.
+     * @param other Object of the same size.
+     * @return True if this set is a subset of other, false otherwise or if sizes mismatch.
+     */
+    bool isSubsetOf(const BBStateControl& other) const;
+
+    /**
+     * @brief Checks if both objects hold the same states.
+     * @param other Object to compare with.
+     * @return True if sizes and states are equal.
+     */
+    bool equals(const BBStateControl& other) const;
+
+    /**
+     * @brief Replaces every state with a mask stored in flash.
+     * @param progmemMask Mask built by BBSC_MASK() in PROGMEM: the size, then state i in bit i % 8 of byte i / 8.
+     * @return False if the mask was built for another number of states (nothing is changed).
+     */
+    bool loadPreset(const uint8_t* progmemMask);
+
+    /**
+     * @brief Checks if the states equal a mask stored in flash.
+     * @param progmemMask Mask built by BBSC_MASK() in PROGMEM.
+     * @return True if the mask has the same number of states and every state matches it.
+     */
+    bool matchesPreset(const uint8_t* progmemMask) const;
+
+    /**
+     * @brief Gets the bitfield bytes, without copying.
+     *
+     * State i is bit i % 8 (LSB first) of byte i / 8 on the little-endian
+     * targets the library supports, the same layout as serializeBinary().
+     * Send it with SPI bit order LSBFIRST to shift state 0 out first.
+     * With heap storage the pointer changes after swapWithSaved(), swap() or a
+     * move, so read it again rather than keeping it. Storage passed to the
+     * constructor never moves.
+     *
+     * @return byteSize() bytes (nullptr if allocation failed).
+     */
+    uint8_t* data() { return (uint8_t*)array; }
+
+    /**
+     * @brief Gets the bitfield bytes, without copying.
+     * @return byteSize() bytes (nullptr if allocation failed).
+     */
+    const uint8_t* data() const { return (const uint8_t*)array; }
+
+    /**
+     * @brief Gets the number of bytes behind data() that hold states.
+     * @return (size + 7) / 8.
+     */
+    size_t byteSize() const { return stateBytes(); }
+
+    /**
+     * @brief Copies the bitfield bytes in the order a peripheral expects.
+     * @param out Destination buffer.
+     * @param len Size of the destination buffer.
+     * @param msbFirst True to put state i in bit 7 - i % 8 of each byte.
+     * @param lastByteFirst True to write the last byte first (daisy-chained shift registers).
+     * @return Bytes written (byteSize(), or 0 if the buffer is too small).
+     */
+    size_t copyBytes(uint8_t* out, size_t len, bool msbFirst, bool lastByteFirst = false) const;
+
+    /**
+     * @brief Resynchronizes the object after the bytes behind data() were written directly.
+     *
+     * Clears the unused bits, refreshes the summary and rank index, forgets
+     * the active index and notifies the observer with -1. The dirty mask does
+     * not learn which states changed.
+     */
+    void dataChanged();
+
     /**
      * @brief Serializes states into a string of '0' and '1'.
      * @param buffer Buffer to store the string.
      * @param bufSize Size of the buffer.
      */
-    void serializeStates(char* buffer, uint8_t bufSize) const;
+    void serializeStates(char* buffer, size_t bufSize) const;
+
+    /**
+     * @brief Gets the size needed for serializeBinary().
+     * @param withCrc True to include the trailing CRC-8 byte.
+     * @return Number of bytes needed.
+     */
+    size_t serializeBinarySize(bool withCrc = true) const;
+
+    /**
+     * @brief Serializes states into a compact binary frame.
+     *
+     * Layout: flags byte (version, index field width, CRC flag), state count,
+     * trueIndex (all ones if none), the bitfield bytes (state i is bit i % 8 of
+     * byte i / 8), then an optional CRC-8 (polynomial 0x07) over all previous
+     * bytes. Count and trueIndex take 1 byte for up to 254 states, 2 bytes for
+     * up to 65534 states and 4 bytes above that (little-endian).
+     *
+     * @param out Buffer to store the frame.
+     * @param cap Capacity of the buffer.
+     * @param withCrc True to append a CRC-8 byte.
+     * @return Number of bytes written, or 0 if the buffer is too small.
+     */
+    size_t serializeBinary(uint8_t* out, size_t cap, bool withCrc = true) const;
+
+    /**
+     * @brief Loads states from a frame written by serializeBinary().
+     * @param in Frame to read.
+     * @param len Length of the frame in bytes.
+     * @return True if the frame was valid and loaded, false otherwise (states unchanged).
+     */
+    bool deserializeBinary(const uint8_t* in, size_t len);
+
+    /**
+     * @brief Gets the size needed for serializeHex().
+     * @return Number of characters needed (includes null terminator).
+     */
+    size_t serializeHexSize() const;
+
+    /**
+     * @brief Serializes the bitfield bytes as uppercase hexadecimal text for logging.
+     *
+     * Two characters per byte, byte 0 first (same byte order as serializeBinary()).
+     *
+     * @param buffer Buffer to store the string.
+     * @param bufSize Size of the buffer.
+     */
+    void serializeHex(char* buffer, size_t bufSize) const;
+
+    /**
+     * @brief Encodes the states that differ from the saved state.
+     *
+     * Writes a header (mode, state count, entry count) followed by either a list
+     * of changed indices, a list of (start, length) runs of changed states, or the
+     * raw XOR bitmap, whichever is smallest. Call saveState() after sending to make
+     * the current states the baseline of the next delta.
+     *
+     * @param out Buffer to store the delta.
+     * @param cap Capacity of the buffer.
+     * @return Number of bytes written, or 0 if the buffer is too small.
+     */
+    size_t encodeDelta(uint8_t* out, size_t cap) const;
+
+    /**
+     * @brief Encodes the states that differ from another object of the same size.
+     * @param base Object holding the baseline states.
+     * @param out Buffer to store the delta.
+     * @param cap Capacity of the buffer.
+     * @return Number of bytes written, or 0 if sizes mismatch or the buffer is too small.
+     */
+    size_t encodeDelta(const BBStateControl& base, uint8_t* out, size_t cap) const;
+
+    /**
+     * @brief Toggles the states listed in a delta written by encodeDelta().
+     * @param in Delta to apply.
+     * @param len Length of the delta in bytes.
+     * @return True if the delta was valid and applied, false otherwise (states unchanged).
+     */
+    bool applyDelta(const uint8_t* in, size_t len);
+
+    /**
+     * @brief Computes a CRC-8 (polynomial 0x07) over a buffer.
+     * @param data Bytes to process.
+     * @param len Number of bytes.
+     * @param crc Initial value, or the result of a previous call to continue.
+     * @return Updated CRC.
+     */
+    static uint8_t crc8(const uint8_t* data, size_t len, uint8_t crc = 0);
 
     /**
      * @brief Saves the current state for later restoration.
@@ -166,40 +728,637 @@ public:
      */
     void restoreSavedState();
 
+    /**
+     * @brief Exchanges the current and saved states by swapping their pointers.
+     *
+     * Same result as restoring the saved state while saving the current one,
+     * without copying: the observer, dirty mask and summary see the change.
+     * With heap storage data() then points at the other buffer. Storage from
+     * the caller, an arena or a BBStateControlT stays in place: the contents
+     * are exchanged word by word instead. Does nothing without a saved state.
+     */
+    void swapWithSaved();
+
+    /**
+     * @brief Checks if the object has a saved state bitfield.
+     * @return True if saveState()/restoreSavedState() are available.
+     */
+    bool hasSavedState() const { return savedState != nullptr; }
+
+    /**
+     * @brief Gets a range over the states that became true since latchEdges().
+     *
+     * The saved state bitfield holds the previous poll: edge detection and
+     * saveState()/restoreSavedState() share it, so use one or the other.
+     *
+     * @return Range of indices where the state is true now and was false.
+     */
+    TrueRange rising() const { return TrueRange{this, VIEW_RISING}; }
+
+    /**
+     * @brief Gets a range over the states that became false since latchEdges().
+     * @return Range of indices where the state is false now and was true.
+     */
+    TrueRange falling() const { return TrueRange{this, VIEW_FALLING}; }
+
+    /**
+     * @brief Gets a range over the states that changed since latchEdges().
+     * @return Range of indices where the state differs from the previous poll.
+     */
+    TrueRange changed() const { return TrueRange{this, VIEW_CHANGED}; }
+
+    /**
+     * @brief Checks if any state changed since latchEdges().
+     * @return True if at least one state differs from the previous poll.
+     */
+    bool hasChanges() const;
+
+    /**
+     * @brief Takes the current states as the previous poll for rising(), falling() and changed().
+     */
+    void latchEdges() { saveState(); }
+
+    /**
+     * @brief Sets the function called after each update that changes a state.
+     *
+     * Called once per public call (setState(), toggleState(), setAllStates(),
+     * range and set operations, ...) that actually changed something, with the
+     * changed index or -1 when several states changed. Inside a batch a single
+     * call is made at the outermost commit(), even if the batch changed states
+     * and then changed them back.
+     *
+     * @param callback Function to call, or nullptr to remove the observer.
+     * @param context User pointer passed to the callback.
+     */
+    void setObserver(ChangeCallback callback, void* context = nullptr);
+
+    /**
+     * @brief Enables the dirty mask that accumulates changed states until consumed.
+     * @return True if the mask is enabled, false if allocation failed.
+     */
+    bool enableDirtyTracking();
+
+    /**
+     * @brief Frees the dirty mask.
+     */
+    void disableDirtyTracking();
+
+    /**
+     * @brief Checks if any state changed since the last consumeDirty().
+     * @return True if the dirty mask is enabled and not empty.
+     */
+    bool isDirty() const;
+
+    /**
+     * @brief Gets a range over the states changed since the last consumeDirty().
+     * @return Range of dirty indices in ascending order.
+     */
+    TrueRange dirtyIndices() const { return TrueRange{this, VIEW_DIRTY}; }
+
+    /**
+     * @brief Clears the dirty mask.
+     */
+    void consumeDirty();
+
+    /**
+     * @brief Writes dirty indices into a buffer and clears them from the mask.
+     * @param out Buffer receiving the indices in ascending order.
+     * @param cap Capacity of the buffer (indices that do not fit stay dirty).
+     * @return Number of indices written.
+     */
+    bbsc_index_t consumeDirty(bbsc_index_t* out, bbsc_index_t cap);
+
+    /**
+     * @brief Enables the summary bitmap used to skip empty and full words.
+     *
+     * Allocates two bitmaps with one bit per bitfield word: one marks words holding
+     * a true state, the other words holding a false state. getFirstTrueIndex(),
+     * findState() and trueIndices() then only visit marked words. Every update
+     * keeps the summary current. Worth it for sets of a few hundred states or more.
+     *
+     * @return True if the summary is enabled, false if allocation failed.
+     */
+    bool enableSummary();
+
+    /**
+     * @brief Frees the summary bitmap (lookups go back to scanning every word).
+     */
+    void disableSummary();
+
+    /**
+     * @brief Checks if the summary bitmap is enabled.
+     * @return True if enableSummary() succeeded.
+     */
+    bool hasSummary() const { return summary != nullptr; }
+
+    /**
+     * @brief Counts the true states before an index.
+     * @param index Position to count up to (exclusive; clamped to the state count).
+     * @return Number of true states with a lower index.
+     */
+    bbsc_index_t rank(bbsc_index_t index) const;
+
+    /**
+     * @brief Finds the k-th true state in ascending order.
+     * @param k Zero-based rank of the state to find.
+     * @return Index of the k-th true state, or -1 if fewer than k + 1 states are true.
+     */
+    bbsc_sindex_t select(bbsc_index_t k) const;
+
+    /**
+     * @brief Enables the cumulative popcount table used by rank() and select().
+     *
+     * Stores, for each word, the number of true states in the words before it.
+     * The table is rebuilt on the first rank() or select() after a change, so both
+     * cost one word lookup (rank) or a binary search over the words (select)
+     * between updates.
+     *
+     * @return True if the table is enabled, false if allocation failed.
+     */
+    bool enableRankIndex();
+
+    /**
+     * @brief Frees the cumulative popcount table.
+     */
+    void disableRankIndex();
+
+    /**
+     * @brief Declares a range of states as a mutually exclusive group.
+     *
+     * Setting a grouped state exclusively (setState() or toggleState()) clears only
+     * the other states of its group, with one masked write per word of the group,
+     * and leaves the rest of the set untouched. Ungrouped states keep the
+     * whole-set behaviour. Inside a batch, group clearing is applied immediately.
+     *
+     * @param start First index of the group.
+     * @param end Last index of the group (inclusive).
+     * @return Group number (0 to 126), or -1 if the range is invalid, overlaps
+     *         another group or allocation failed.
+     */
+    int8_t defineGroup(bbsc_index_t start, bbsc_index_t end);
+
+    /**
+     * @brief Removes all groups (every state goes back to whole-set exclusivity).
+     */
+    void clearGroups();
+
+    /**
+     * @brief Gets the number of groups defined.
+     * @return Number of groups.
+     */
+    uint8_t getGroupCount() const { return group_count; }
+
+    /**
+     * @brief Finds the group holding a state.
+     * @param index Index of the state.
+     * @return Group number, or -1 if the state is not grouped.
+     */
+    int8_t groupOf(bbsc_index_t index) const;
+
+    /**
+     * @brief Gets the active state of a group.
+     *
+     * Each group remembers the last state set in it, so the lookup is O(1) while
+     * that state stays true. Otherwise the group's words are scanned once.
+     *
+     * @param group Group number.
+     * @return Index of the active state, or -1 if none is true or the group is invalid.
+     */
+    bbsc_sindex_t getGroupActive(uint8_t group) const;
+
+    /**
+     * @brief Clears every state of a group.
+     * @param group Group number.
+     */
+    void clearGroup(uint8_t group);
+
+#if BBSC_STATS
+    /**
+     * @brief Gets the instrumentation counters (BBSC_STATS builds only).
+     * @return Counters shared by every object since the last resetStats().
+     */
+    static const BBStateStats& stats();
+
+    /**
+     * @brief Zeroes the instrumentation counters.
+     */
+    static void resetStats();
+
+    /**
+     * @brief Writes the instrumentation counters as one "name=value" text line.
+     * @param buffer Buffer to store the text.
+     * @param bufSize Size of the buffer.
+     * @return Length of the full text (the output is truncated if it is larger).
+     */
+    static size_t formatStats(char* buffer, size_t bufSize);
+
+    /**
+     * @brief Reads the clock used by the tick counters.
+     *
+     * CPU cycles from the DWT counter on Cortex-M3/M4/M7 and from the core
+     * counter on ESP boards, micros() elsewhere.
+     *
+     * @return Current clock value.
+     */
+    static uint32_t statsClock();
+#endif
+
+    /**
+     * @brief Starts a batch of updates. Batches may be nested.
+     *
+     * Inside a batch, the whole-set clearing of exclusive requests from setState()
+     * and toggleState() is not applied immediately: commit() clears once for the
+     * last state set exclusively. States set after that request are kept, so the
+     * result is the same as without the batch. Grouped states are cleared
+     * immediately (see defineGroup()).
+     */
+    void beginBatch();
+
+    /**
+     * @brief Ends a batch and applies any deferred exclusive clearing.
+     */
+    void commit();
+
+    /**
+     * @brief Checks if a batch is open.
+     * @return True between beginBatch() and the matching commit().
+     */
+    bool inBatch() const { return batchDepth > 0; }
+
 private:
-    uint8_t def_size;         ///< Total number of states.
-    uint8_t byte_size;        ///< Number of bytes needed for the bitfield.
-    uint8_t* array;           ///< Bitfield array storing states.
-    uint8_t* savedState;      ///< Array for saving previous state.
-    int8_t trueIndex;         ///< Index of the first true state (-1 if none).
-    int8_t savedTrueIndex;    ///< Saved trueIndex.
+    friend class AtomicBBStateControl;
+    friend class BBStatePersist;
+    friend class BBStateTimers;
+    friend class BBStateDebouncer;
+    friend class BBStatePorts;
+    friend class BBStateMachine;
+    template <bbsc_index_t N, bool WithSavedState> friend class BBStateControlT;
+    template <uint8_t Depth, uint16_t PoolBytes> friend class BBStateHistory;
+
+    static const uint8_t VIEW_TRUE = 0;     ///< Iterate true states.
+    static const uint8_t VIEW_RISING = 1;   ///< Iterate states set since the saved state.
+    static const uint8_t VIEW_FALLING = 2;  ///< Iterate states cleared since the saved state.
+    static const uint8_t VIEW_CHANGED = 3;  ///< Iterate states that differ from the saved state.
+    static const uint8_t VIEW_DIRTY = 4;    ///< Iterate states in the dirty mask.
+    static const uint8_t MAX_GROUPS = 127;  ///< Limit of defineGroup().
+    static const uint8_t PENDING_KEEP = 4;  ///< States recorded after a deferred exclusive request.
+
+    /**
+     * @struct StateGroup
+     * @brief Range of mutually exclusive states.
+     */
+    struct StateGroup {
+        bbsc_index_t start;   ///< First index of the group.
+        bbsc_index_t end;     ///< Last index of the group (inclusive).
+        bbsc_sindex_t active; ///< Last state set in the group (-1 if none).
+    };
+
+    bbsc_index_t def_size;         ///< Total number of states.
+    bbsc_index_t word_size;        ///< Number of words needed for the bitfield.
+    bbsc_word_t* array;       ///< Bitfield array storing states.
+    bbsc_word_t* savedState;  ///< Array for saving previous state.
+    mutable bbsc_sindex_t trueIndex; ///< Index of the active true state (-1 if none, -2 if to be recomputed).
+    bbsc_sindex_t savedTrueIndex;    ///< Saved trueIndex.
+    uint8_t batchDepth;       ///< Nesting level of open batches.
+    bbsc_index_t pendingExclusive; ///< Index to keep at commit (all ones if none).
+    bbsc_index_t pendingKeep[PENDING_KEEP]; ///< States set after pendingExclusive, also kept at commit.
+    uint8_t pendingKeepCount; ///< Entries used in pendingKeep.
+    bool ownsStorage;         ///< True if array and savedState were allocated by this object.
+    bool inlineStorage;       ///< True if array and savedState live inside the object (BBStateControlT).
+    bbsc_word_t* summary;     ///< Non-empty word bitmap followed by non-full word bitmap (nullptr if disabled).
+    bbsc_index_t* rankTable;  ///< True states before each word (nullptr if disabled).
+    mutable bool rankDirty;   ///< True if rankTable must be rebuilt before use.
+    bbsc_word_t* dirty;       ///< States changed since consumeDirty() (nullptr if disabled).
+    ChangeCallback observer;  ///< Change notification callback (nullptr if none).
+    void* observerContext;    ///< User pointer passed to observer.
+    bbsc_sindex_t changeIndex; ///< Change recorded for the next notification (-1 if several, -2 if none).
+    StateGroup* groups;       ///< Exclusive groups (nullptr if none).
+    uint8_t group_count;      ///< Number of exclusive groups.
 
     /**
      * @brief Checks if an index is valid.
      * @param index Index to check.
      * @return True if the index is valid, false otherwise.
      */
-    bool isValidIndex(uint8_t index) const;
+    bool isValidIndex(bbsc_index_t index) const;
 
     /**
      * @brief Clears all states except the specified one.
      * @param index Index of the state to keep.
      */
-    void clearOthers(uint8_t index);
+    void clearOthers(bbsc_index_t index);
 
     /**
      * @brief Sets a bit at the specified index.
      * @param index Index of the bit.
      * @param state Value of the bit (true/false).
      */
-    void setBit(uint8_t index, bool state);
+    void setBit(bbsc_index_t index, bool state);
 
     /**
      * @brief Gets the value of a bit at the specified index.
      * @param index Index of the bit.
      * @return Value of the bit (true/false).
      */
-    bool getBit(uint8_t index) const;
+    bool getBit(bbsc_index_t index) const;
+
+    /**
+     * @brief Gets the mask of valid bits in the last word.
+     * @return Mask with one bit set per state stored in the last word.
+     */
+    bbsc_word_t lastWordMask() const;
+
+    /**
+     * @brief Gets the number of bytes holding states.
+     * @return (def_size + 7) / 8.
+     */
+    bbsc_index_t stateBytes() const { return (def_size + 7) >> 3; }
+
+    /**
+     * @brief Reads one byte of the bitfield, independent of the word size.
+     * @param index Byte index (0 to stateBytes()-1).
+     * @return Byte value; state i is bit i % 8 of byte i / 8.
+     */
+    uint8_t getByte(bbsc_index_t index) const;
+
+    /**
+     * @brief Builds one bitfield word from bytes in serialized order.
+     * @param bytes stateBytes() bytes; state i is bit i % 8 of byte i / 8.
+     * @param word Word index.
+     * @param fromFlash True if bytes is in PROGMEM.
+     * @return Word value, with the unused bits of the last word cleared.
+     */
+    bbsc_word_t packWord(const uint8_t* bytes, bbsc_index_t word, bool fromFlash = false) const;
+
+    /**
+     * @brief Checks that a flash mask was built for this number of states.
+     * @param progmemMask Mask built by BBSC_MASK() in PROGMEM.
+     * @return True if the size stored before the mask bytes equals the size of the object.
+     */
+    bool presetFits(const uint8_t* progmemMask) const;
+
+    /**
+     * @brief Writes one bitfield word and records the change.
+     *
+     * Every write to the bitfield goes through here so the summary, the rank
+     * table, the dirty mask and the pending notification stay current.
+     *
+     * @param word Word index.
+     * @param value New word value.
+     */
+    void storeWord(bbsc_index_t word, bbsc_word_t value);
+
+    /**
+     * @brief Records a change already written to a word (summary, rank, dirty, notification).
+     * @param word Word index.
+     * @param diff Bits that changed (non-zero).
+     */
+    void noteWordChange(bbsc_index_t word, bbsc_word_t diff);
+
+    /**
+     * @brief Frees every allocation and leaves the object with zero states.
+     */
+    void release();
+
+    /**
+     * @brief Writes the same value to every word (unused bits of the last word stay clear).
+     * @param fill Word value.
+     */
+    void fillWords(bbsc_word_t fill);
+
+    /**
+     * @brief Ends a public update: notifies the observer of the recorded change.
+     *
+     * Does nothing inside a batch; commit() sends one notification for the batch.
+     */
+    void endChange();
+
+    /**
+     * @brief Encodes the difference between the bitfield and a baseline.
+     * @param base Baseline words (same word_size as array).
+     * @param out Buffer to store the delta.
+     * @param cap Capacity of the buffer.
+     * @return Number of bytes written, or 0 if the buffer is too small.
+     */
+    size_t encodeDeltaFrom(const bbsc_word_t* base, uint8_t* out, size_t cap) const;
+
+    /**
+     * @brief Validates a delta written by encodeDelta() for this object's size.
+     * @param in Delta to check.
+     * @param len Length of the delta in bytes.
+     * @return Number of entries in the delta, or -1 if it is invalid.
+     */
+    int32_t checkDelta(const uint8_t* in, size_t len) const;
+
+    /**
+     * @brief Toggles the states listed in a delta in the saved state only.
+     *
+     * The live bitfield, the observer and the change tracking are not touched.
+     *
+     * @param in Delta written by encodeDelta().
+     * @param len Length of the delta in bytes.
+     * @param index savedTrueIndex of the resulting saved state.
+     * @return False if there is no saved state or the delta is invalid.
+     */
+    bool applyDeltaToSaved(const uint8_t* in, size_t len, bbsc_sindex_t index);
+
+    /**
+     * @brief Clears the other states of the index's group, or of the whole set
+     *        (deferred to commit() inside a batch) if the index is not grouped.
+     * @param index Index of the state to keep.
+     */
+    void applyExclusive(bbsc_index_t index);
+
+    /**
+     * @brief Records a state just set to true as the active state of its group.
+     * @param index Index of the state.
+     */
+    void noteGroupActive(bbsc_index_t index);
+
+    /**
+     * @brief Gets trueIndex, recomputing it first if it was invalidated.
+     * @return Index of the active true state, or -1 if none.
+     */
+    bbsc_sindex_t resolvedTrueIndex() const;
+
+    /**
+     * @brief Marks trueIndex for recomputation and drops any pending exclusive request.
+     *
+     * Called after the bitfield is overwritten in bulk.
+     */
+    void invalidateTrueIndex();
+
+    /**
+     * @brief Applies a deferred exclusive request now, keeping the states recorded after it.
+     */
+    void flushPendingExclusive();
+
+    /**
+     * @brief Records a state about to be set after a deferred exclusive request.
+     *
+     * Applies the request first if the record is full.
+     *
+     * @param index Index of the state.
+     */
+    void keepAfterPending(bbsc_index_t index);
+
+    /**
+     * @brief Checks if the deferred exclusive request will clear a state at commit().
+     * @param index Index of the state.
+     * @return True if a request is pending and the state is neither its index nor recorded after it.
+     */
+    bool pendingClears(bbsc_index_t index) const;
+
+    /**
+     * @brief Keeps trueIndex if its state is still true, otherwise marks it for recomputation.
+     */
+    void revalidateTrueIndex();
+
+    /**
+     * @brief Gets one word of an iteration view.
+     * @param view VIEW_TRUE, VIEW_RISING, VIEW_FALLING, VIEW_CHANGED or VIEW_DIRTY.
+     * @param word Word index.
+     * @return Word whose set bits are the indices visited by the view.
+     */
+    bbsc_word_t viewWord(uint8_t view, bbsc_index_t word) const;
+
+    /**
+     * @brief Validates a range and clamps its end to the last state.
+     * @param start Start index of the range.
+     * @param end End index of the range, clamped in place.
+     * @return True if the range holds at least one state.
+     */
+    bool clampRange(bbsc_index_t start, bbsc_index_t& end) const;
+
+    /**
+     * @brief Writes a range of states one word at a time.
+     * @param start Start index of the range (validated).
+     * @param end End index of the range (validated, inclusive).
+     * @param op 0 to clear, 1 to set, 2 to invert.
+     */
+    void writeRange(bbsc_index_t start, bbsc_index_t end, uint8_t op);
+
+    /**
+     * @brief Gets the number of words in each summary bitmap.
+     * @return One bit per bitfield word, rounded up to whole words.
+     */
+    bbsc_index_t summaryWords() const { return BBSC_WORDS_FOR(word_size); }
+
+    /**
+     * @brief Updates the summary bits of one bitfield word.
+     * @param word Index of the word that changed.
+     */
+    void updateSummary(bbsc_index_t word);
+
+    /**
+     * @brief Recomputes the summary from the bitfield (does nothing if disabled).
+     */
+    void rebuildSummary();
+
+    /**
+     * @brief Rebuilds the rank table if it was marked stale.
+     */
+    void refreshRankTable() const;
+
+    /**
+     * @brief Finds the first word at or after a position holding a true or false state.
+     * @param from First word to consider.
+     * @param withTrue True to look for a true state, false for a false state.
+     * @return Word index, or word_size if there is none.
+     */
+    bbsc_index_t nextWord(bbsc_index_t from, bool withTrue) const;
+
+    /**
+     * @brief Finds the last word at or before a position holding a true state.
+     * @param from Last word to consider.
+     * @return Word index, or word_size if there is none.
+     */
+    bbsc_index_t prevTrueWord(bbsc_index_t from) const;
+
+    /**
+     * @brief Checks if another object can be combined word by word with this one.
+     * @param other Object to check.
+     * @return True if both have storage and the same size.
+     */
+    bool sameShape(const BBStateControl& other) const;
+};
+
+/**
+ * @struct BBStateStorageT
+ * @brief Inline bitfield storage for BBStateControlT, sized at compile time.
+ * @tparam N Number of states.
+ * @tparam WithSavedState True to reserve the saved state bitfield.
+ */
+template <bbsc_index_t N, bool WithSavedState>
+struct BBStateStorageT {
+    static constexpr bbsc_index_t WORD_SIZE = BBSC_WORDS_FOR(N);  ///< Words needed for the bitfield.
+
+    bbsc_word_t bits[WORD_SIZE];    ///< Bitfield array storing states.
+    bbsc_word_t saved[WORD_SIZE];   ///< Array for saving previous state.
+
+    bbsc_word_t* savedStorage() { return saved; }
+};
+
+/**
+ * @brief Storage without a saved state bitfield.
+ */
+template <bbsc_index_t N>
+struct BBStateStorageT<N, false> {
+    static constexpr bbsc_index_t WORD_SIZE = BBSC_WORDS_FOR(N);  ///< Words needed for the bitfield.
+
+    bbsc_word_t bits[WORD_SIZE];    ///< Bitfield array storing states.
+
+    bbsc_word_t* savedStorage() { return nullptr; }
+};
+
+template <bbsc_index_t N, bool WithSavedState>
+constexpr bbsc_index_t BBStateStorageT<N, WithSavedState>::WORD_SIZE;
+
+template <bbsc_index_t N>
+constexpr bbsc_index_t BBStateStorageT<N, false>::WORD_SIZE;
+
+/**
+ * @class BBStateControlT
+ * @brief BBStateControl with compile-time size and inline storage.
+ *
+ * Both bitfields live inside the object, so global instances need no heap
+ * allocation and no constructor-time `new`. The object can be passed anywhere a
+ * BBStateControl reference is expected.
+ *
+ * @tparam N Number of states to manage (1 to BBSC_MAX_STATES).
+ * @tparam WithSavedState False to drop the saved state bitfield (saveState() does nothing).
+ */
+template <bbsc_index_t N, bool WithSavedState = true>
+class BBStateControlT : private BBStateStorageT<N, WithSavedState>, public BBStateControl {
+    static_assert(N > 0 && N <= BBSC_MAX_STATES, "BBStateControlT supports 1 to BBSC_MAX_STATES states");
+    typedef BBStateStorageT<N, WithSavedState> Storage;
+
+public:
+    static constexpr bbsc_index_t BYTE_SIZE = (N + 7) >> 3;        ///< Bytes needed for the bitfield.
+    static constexpr bbsc_index_t WORD_SIZE = Storage::WORD_SIZE;  ///< Words needed for the bitfield.
+    static constexpr uint8_t LAST_BYTE_MASK =
+        (N & 0x07) ? (uint8_t)((1 << (N & 0x07)) - 1) : 0xFF; ///< Valid bits in the last byte.
+
+    /**
+     * @brief Initializes the object with N states, all false.
+     */
+    BBStateControlT() : Storage(), BBStateControl(N, this->bits, this->savedStorage()) {
+        inlineStorage = true; // swap() and moves through BBStateControl& refuse this object
+    }
+
+    BBStateControlT(const BBStateControlT&) = delete;
+    BBStateControlT& operator=(const BBStateControlT&) = delete;
+    BBStateControlT(BBStateControlT&&) = delete;             ///< Storage is inside the object.
+    BBStateControlT& operator=(BBStateControlT&&) = delete;  ///< Storage is inside the object.
 };
 
+template <bbsc_index_t N, bool WithSavedState>
+constexpr bbsc_index_t BBStateControlT<N, WithSavedState>::BYTE_SIZE;
+
+template <bbsc_index_t N, bool WithSavedState>
+constexpr bbsc_index_t BBStateControlT<N, WithSavedState>::WORD_SIZE;
+
+template <bbsc_index_t N, bool WithSavedState>
+constexpr uint8_t BBStateControlT<N, WithSavedState>::LAST_BYTE_MASK;
+
 #endif  // BIT_BASED_STATE_CONTROL_H
@@ -0,0 +1,98 @@
+/**
+ * @file bit_based_state_debounce.cpp
+ * @brief Implementation of BBStateDebouncer.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_debounce.h"
+#include "bit_based_state_detail.h"
+#include <Arduino.h>
+
+// Counter value of an input that agrees with its state
+static const bbsc_word_t IDLE = (bbsc_word_t)~(bbsc_word_t)0;
+
+// Constructor: Allocates two counter planes per word
+BBStateDebouncer::BBStateDebouncer(BBStateControl& target)
+    : target(target), word_size(target.array ? target.word_size : 0), counters(nullptr) {
+    if (word_size == 0) return;
+    counters = new bbsc_word_t[2 * (size_t)word_size];
+    if (!counters) {
+        word_size = 0;
+        return;
+    }
+    reset();
+}
+
+// Destructor: Frees allocated memory
+BBStateDebouncer::~BBStateDebouncer() {
+    delete[] counters;
+}
+
+// Runs the vertical counters of one word and flips the inputs that settled
+void BBStateDebouncer::step(bbsc_index_t word, bbsc_word_t raw, bbsc_word_t mask) {
+    if (word == word_size - 1) mask &= target.lastWordMask(); // Unused bits stay clear
+    bbsc_word_t& ct0 = counters[word];
+    bbsc_word_t& ct1 = counters[word_size + word];
+    bbsc_word_t state = target.array[word];
+    bbsc_word_t delta = (bbsc_word_t)((raw ^ state) & mask);  // Inputs that disagree
+    bbsc_word_t c0 = (bbsc_word_t)~(ct0 & delta);              // Count down, or reset to idle
+    bbsc_word_t c1 = (bbsc_word_t)(c0 ^ (ct1 & delta));
+    bbsc_word_t flip = (bbsc_word_t)(delta & c0 & c1);         // Counter wrapped: input is stable
+    ct0 = (bbsc_word_t)((ct0 & ~mask) | (c0 & mask));
+    ct1 = (bbsc_word_t)((ct1 & ~mask) | (c1 & mask));
+    if (flip) target.storeWord(word, state ^ flip);
+}
+
+// Feeds a sample of every input
+void BBStateDebouncer::sample(const bbsc_word_t* raw) {
+    if (!counters || !raw) return;
+    bool changed = false;
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        bbsc_word_t before = target.array[i];
+        step(i, raw[i], IDLE);
+        if (target.array[i] != before) changed = true;
+    }
+    if (!changed) return;
+    target.invalidateTrueIndex();
+    target.endChange();
+}
+
+// Feeds a sample of one word of inputs
+void BBStateDebouncer::sample(bbsc_index_t word, bbsc_word_t raw) {
+    if (!counters || word >= word_size) return;
+    bbsc_word_t before = target.array[word];
+    step(word, raw, IDLE);
+    if (target.array[word] == before) return;
+    target.invalidateTrueIndex();
+    target.endChange();
+}
+
+// Feeds a sample of eight inputs
+void BBStateDebouncer::sampleByte(bbsc_index_t byte, uint8_t raw) {
+    bbsc_index_t word = byte / WORD_BYTES;
+    if (!counters || word >= word_size) return;
+    uint8_t shift = (byte % WORD_BYTES) * 8;
+    bbsc_word_t before = target.array[word];
+    step(word, (bbsc_word_t)((bbsc_word_t)raw << shift), (bbsc_word_t)((bbsc_word_t)0xFF << shift));
+    if (target.array[word] == before) return;
+    target.invalidateTrueIndex();
+    target.endChange();
+}
+
+// Checks if any counter is running
+bool BBStateDebouncer::isSettling() const {
+    for (bbsc_index_t i = 0; i < word_size; i++) {
+        if ((bbsc_word_t)(counters[i] & counters[word_size + i]) != IDLE) return true;
+    }
+    return false;
+}
+
+// Restarts every counter
+void BBStateDebouncer::reset() {
+    for (size_t i = 0; i < 2 * (size_t)word_size; i++) {
+        counters[i] = IDLE;
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file bit_based_state_debounce.h
+ * @brief Parallel input debouncing for BBStateControl using vertical counters.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_DEBOUNCE_H
+#define BIT_BASED_STATE_DEBOUNCE_H
+
+#include <stdint.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStateDebouncer
+ * @brief Debounces raw input samples into the states of a BBStateControl.
+ *
+ * Each state has a 2-bit counter stored "vertically": bit 0 of every counter
+ * of a word lives in one word and bit 1 in another, so a whole word of inputs
+ * is debounced with a handful of bitwise operations. A state changes once its
+ * input has differed from it for SAMPLES consecutive samples; a sample that
+ * agrees resets the count. Stable words are written to the target in bulk, so
+ * its observer, dirty mask and edge views see only debounced changes.
+ */
+class BBStateDebouncer {
+public:
+    static const uint8_t SAMPLES = 4;  ///< Consecutive samples needed to change a state.
+
+    /**
+     * @brief Initializes one counter per state of an object.
+     * @param target Object receiving the debounced states (must outlive the debouncer).
+     */
+    explicit BBStateDebouncer(BBStateControl& target);
+
+    /**
+     * @brief Frees allocated memory.
+     */
+    ~BBStateDebouncer();
+
+    BBStateDebouncer(const BBStateDebouncer&) = delete;
+    BBStateDebouncer& operator=(const BBStateDebouncer&) = delete;
+
+    /**
+     * @brief Feeds one raw sample of every input.
+     * @param raw wordSize() words; input i is bit i % BBSC_WORD_BITS of word i / BBSC_WORD_BITS.
+     */
+    void sample(const bbsc_word_t* raw);
+
+    /**
+     * @brief Feeds one raw sample of the inputs held by one word.
+     * @param word Word index (0 to wordSize()-1).
+     * @param raw Sampled inputs.
+     */
+    void sample(bbsc_index_t word, bbsc_word_t raw);
+
+    /**
+     * @brief Feeds one raw sample of eight inputs, for example a whole PORTx read.
+     * @param byte Byte index: inputs byte * 8 to byte * 8 + 7.
+     * @param raw Sampled inputs.
+     */
+    void sampleByte(bbsc_index_t byte, uint8_t raw);
+
+    /**
+     * @brief Checks if any input is still bouncing.
+     * @return True if some counter is running.
+     */
+    bool isSettling() const;
+
+    /**
+     * @brief Restarts every counter (the states are kept).
+     */
+    void reset();
+
+    /**
+     * @brief Gets the number of words fed by sample(const bbsc_word_t*).
+     * @return Words of the target bitfield (0 if allocation failed).
+     */
+    bbsc_index_t wordSize() const { return word_size; }
+
+private:
+    BBStateControl& target;  ///< Object receiving the debounced states.
+    bbsc_index_t word_size;  ///< Number of words in the target bitfield.
+    bbsc_word_t* counters;   ///< Counter bit 0 planes followed by counter bit 1 planes.
+
+    /**
+     * @brief Runs the counters of the masked inputs of one word.
+     * @param word Word index (validated).
+     * @param raw Sampled inputs.
+     * @param mask Inputs present in the sample.
+     */
+    void step(bbsc_index_t word, bbsc_word_t raw, bbsc_word_t mask);
+};
+
+#endif  // BIT_BASED_STATE_DEBOUNCE_H
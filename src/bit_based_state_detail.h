@@ -0,0 +1,187 @@
+/**
+ * @file bit_based_state_detail.h
+ * @brief Internal helpers shared by the library's translation units (word bit tricks, atomics).
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ *
+ * Included only from .cpp files of the library; not part of the public API.
+ */
+
+#ifndef BIT_BASED_STATE_DETAIL_H
+#define BIT_BASED_STATE_DETAIL_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "bit_based_state_control.h"
+
+#if defined(__AVR__)
+#define BBSC_LOCKED_RMW 1
+#elif defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_MBED_RP2040)
+#include <hardware/sync.h>
+#define BBSC_LOCKED_RMW 1
+#ifndef BBSC_RP2040_SPINLOCK
+#define BBSC_RP2040_SPINLOCK PICO_SPINLOCK_ID_STRIPED_FIRST  ///< Hardware spinlock shared by both cores.
+#endif
+#elif defined(__ARM_ARCH_6M__)
+#define BBSC_LOCKED_RMW 1  // Cortex-M0/M0+ (SAMD21): no LDREX/STREX, __atomic RMW calls libatomic
+#else
+#define BBSC_LOCKED_RMW 0
+#endif
+
+// Bytes per bitfield word
+static const uint8_t WORD_BYTES = BBSC_WORD_BITS / 8;
+
+// Counts the set bits of a word
+static inline uint8_t popcountWord(bbsc_word_t w) {
+#if BBSC_WORD_BITS == 32
+    return (uint8_t)__builtin_popcountl(w);
+#else
+    uint8_t count = 0;
+    while (w) {
+        w &= (bbsc_word_t)(w - 1); // Clear lowest set bit
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Returns the position of the highest set bit (w must be non-zero)
+static inline uint8_t msbWord(bbsc_word_t w) {
+#if BBSC_WORD_BITS == 32
+    return (uint8_t)(31 - __builtin_clz(w));
+#else
+    uint8_t pos = 0;
+    while (w >>= 1) pos++;
+    return pos;
+#endif
+}
+
+// Returns the position of the lowest set bit (w must be non-zero)
+static inline uint8_t ctzWord(bbsc_word_t w) {
+#if BBSC_WORD_BITS == 32
+    return (uint8_t)__builtin_ctzl(w);
+#else
+    uint8_t pos = 0;
+    while (!(w & 1)) {
+        w >>= 1;
+        pos++;
+    }
+    return pos;
+#endif
+}
+
+#if BBSC_LOCKED_RMW
+/**
+ * @class AtomicSection
+ * @brief Guards one read-modify-write on targets without atomic RMW instructions.
+ *
+ * Masks interrupts on AVR and single-core ARMv6-M. On RP2040 it also takes a
+ * hardware spinlock, so the two cores exclude each other.
+ */
+class AtomicSection {
+public:
+#if defined(__AVR__)
+    AtomicSection() : sreg(SREG) { cli(); }
+    ~AtomicSection() { SREG = sreg; }
+#elif defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_MBED_RP2040)
+    AtomicSection() : lock(spin_lock_instance(BBSC_RP2040_SPINLOCK)), saved(spin_lock_blocking(lock)) {}
+    ~AtomicSection() { spin_unlock(lock, saved); }
+#else
+    AtomicSection() : primask(__get_PRIMASK()) { __disable_irq(); }
+    ~AtomicSection() {
+        if (!primask) __enable_irq();
+    }
+#endif
+
+private:
+#if defined(__AVR__)
+    uint8_t sreg;          ///< Status register (interrupt flag) on entry.
+#elif defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_MBED_RP2040)
+    spin_lock_t* lock;     ///< Spinlock held by the section.
+    uint32_t saved;        ///< Interrupt state on entry.
+#else
+    uint32_t primask;      ///< PRIMASK on entry (non-zero if interrupts were already masked).
+#endif
+};
+#endif
+
+// Atomically ORs a mask into a word and returns the previous value
+template <typename T>
+static inline T atomicFetchOr(volatile T* w, T mask) {
+#if BBSC_LOCKED_RMW
+    AtomicSection section;
+    T old = *w;
+    *w = old | mask;
+    return old;
+#else
+    return __atomic_fetch_or(w, mask, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Atomically ANDs a mask into a word and returns the previous value
+template <typename T>
+static inline T atomicFetchAnd(volatile T* w, T mask) {
+#if BBSC_LOCKED_RMW
+    AtomicSection section;
+    T old = *w;
+    *w = old & mask;
+    return old;
+#else
+    return __atomic_fetch_and(w, mask, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Atomically XORs a mask into a word and returns the previous value
+template <typename T>
+static inline T atomicFetchXor(volatile T* w, T mask) {
+#if BBSC_LOCKED_RMW
+    AtomicSection section;
+    T old = *w;
+    *w = old ^ mask;
+    return old;
+#else
+    return __atomic_fetch_xor(w, mask, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Atomically adds to a word (wrapping) and returns the previous value
+template <typename T>
+static inline T atomicFetchAdd(volatile T* w, T value) {
+#if BBSC_LOCKED_RMW
+    AtomicSection section;
+    T old = *w;
+    *w = (T)(old + value);
+    return old;
+#else
+    return __atomic_fetch_add(w, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Atomically replaces a word with zero and returns the previous value
+template <typename T>
+static inline T atomicExchangeZero(volatile T* w) {
+#if BBSC_LOCKED_RMW
+    AtomicSection section;
+    T old = *w;
+    *w = 0;
+    return old;
+#else
+    return __atomic_exchange_n(w, (T)0, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Atomically reads a word
+template <typename T>
+static inline T atomicLoad(const volatile T* w) {
+#if defined(__AVR__)
+    if (sizeof(T) == 1) return *w; // Single-byte loads are atomic on AVR
+    AtomicSection section;
+    return *w;
+#else
+    return __atomic_load_n(w, __ATOMIC_ACQUIRE); // Aligned word loads are lock-free everywhere
+#endif
+}
+
+#endif  // BIT_BASED_STATE_DETAIL_H
@@ -0,0 +1,178 @@
+/**
+ * @file bit_based_state_history.h
+ * @brief Multi-level undo history for BBStateControl, stored as deltas.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_HISTORY_H
+#define BIT_BASED_STATE_HISTORY_H
+
+#include <stdint.h>
+#include <string.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStateHistory
+ * @brief Snapshot stack of compile-time depth for a BBStateControl.
+ *
+ * The newest snapshot is kept in full in the object's saved state bitfield.
+ * Each older snapshot is stored as the delta (see BBStateControl::encodeDelta())
+ * between it and the snapshot above it, so a stack of similar states costs a
+ * few bytes per level. When the pool is full the oldest snapshots are dropped
+ * and counted in dropped(). undo() writes the live states once, so observers
+ * and dirty tracking see only the net change.
+ *
+ * The history owns the saved state: do not call saveState() on the object
+ * directly while a history is attached to it.
+ *
+ * @tparam Depth Maximum number of snapshots, including the full one (1 or more).
+ * @tparam PoolBytes Bytes reserved for the older snapshots' deltas.
+ */
+template <uint8_t Depth, uint16_t PoolBytes = (Depth > 1 ? (Depth - 1) * 16 : 1)>
+class BBStateHistory {
+    static_assert(Depth >= 1, "BBStateHistory needs a depth of at least 1");
+    static_assert(PoolBytes >= 1, "BBStateHistory needs a non-empty pool");
+
+public:
+    /**
+     * @brief Initializes an empty history.
+     */
+    BBStateHistory() : used(0), entries(0), hasTop(false), topTrueIndex(NO_INDEX), drop_count(0) {}
+
+    /**
+     * @brief Pushes the current states as the newest snapshot.
+     * @param states Object to snapshot (must have a saved state bitfield).
+     * @return True if the snapshot was taken, false if the object has no saved state.
+     *         Older snapshots discarded to make room are counted in dropped().
+     */
+    bool push(BBStateControl& states) {
+        if (!states.hasSavedState()) return false;
+        if (hasTop && Depth > 1) {
+            if (entries >= Depth - 1) dropOldest();
+            for (;;) {
+                size_t n = 0;
+                if (used + ENTRY_HEADER < PoolBytes) {
+                    n = states.encodeDelta(pool + used + ENTRY_HEADER, PoolBytes - used - ENTRY_HEADER);
+                }
+                if (n) {
+                    uint16_t len = (uint16_t)n;
+                    memcpy(pool + used, &len, sizeof(len));
+                    memcpy(pool + used + sizeof(len), &topTrueIndex, sizeof(topTrueIndex));
+                    used += n + ENTRY_HEADER;
+                    entries++;
+                    break;
+                }
+                if (entries == 0) { // Delta does not fit: older snapshot is lost
+                    drop_count++;
+                    break;
+                }
+                dropOldest();
+            }
+        }
+        states.saveState();
+        bbsc_sindex_t index = states.getTrueIndex();
+        topTrueIndex = index == -1 ? NO_INDEX : (bbsc_index_t)index;
+        hasTop = true;
+        return true;
+    }
+
+    /**
+     * @brief Restores the newest snapshot and removes it from the history.
+     * @param states Object the snapshots were taken from.
+     * @return True if a snapshot was restored, false if the history is empty.
+     */
+    bool undo(BBStateControl& states) {
+        if (!hasTop || !states.hasSavedState()) return false;
+        states.restoreSavedState();
+        if (entries == 0) {
+            hasTop = false;
+            topTrueIndex = NO_INDEX;
+            return true;
+        }
+
+        // Locate the newest delta (entries are stored oldest first)
+        uint16_t pos = 0;
+        for (uint8_t i = 1; i < entries; i++) {
+            pos += entryLength(pos) + ENTRY_HEADER;
+        }
+        uint16_t len = entryLength(pos);
+        bbsc_index_t prevIndex;
+        memcpy(&prevIndex, pool + pos + sizeof(len), sizeof(prevIndex));
+        const uint8_t* delta = pool + pos + ENTRY_HEADER;
+
+        // Rebuild the older snapshot in the saved slot, leaving the live states alone
+        states.applyDeltaToSaved(delta, len, prevIndex == NO_INDEX ? -1 : (bbsc_sindex_t)prevIndex);
+
+        topTrueIndex = prevIndex;
+        used = pos;
+        entries--;
+        return true;
+    }
+
+    /**
+     * @brief Gets the number of snapshots available to undo().
+     * @return Number of snapshots (0 to Depth).
+     */
+    uint8_t size() const { return hasTop ? entries + 1 : 0; }
+
+    /**
+     * @brief Gets the number of pool bytes in use.
+     * @return Bytes used by the stored deltas.
+     */
+    uint16_t bytesUsed() const { return used; }
+
+    /**
+     * @brief Gets the number of snapshots discarded by push() for lack of depth or pool space.
+     * @return Snapshots lost since construction.
+     */
+    uint32_t dropped() const { return drop_count; }
+
+    /**
+     * @brief Discards all snapshots.
+     */
+    void clear() {
+        used = 0;
+        entries = 0;
+        hasTop = false;
+        topTrueIndex = NO_INDEX;
+    }
+
+private:
+    static const uint8_t ENTRY_HEADER = sizeof(uint16_t) + sizeof(bbsc_index_t);  ///< Delta length and trueIndex of the snapshot.
+    static const bbsc_index_t NO_INDEX = (bbsc_index_t)~(bbsc_index_t)0;          ///< Stored trueIndex for "none".
+
+    uint8_t pool[PoolBytes];  ///< Deltas of older snapshots, oldest first.
+    uint16_t used;            ///< Bytes of pool in use.
+    uint8_t entries;          ///< Number of deltas stored.
+    bool hasTop;              ///< True if the saved state holds the newest snapshot.
+    bbsc_index_t topTrueIndex; ///< trueIndex of the newest snapshot.
+    uint32_t drop_count;      ///< Snapshots discarded by push().
+
+    /**
+     * @brief Reads the delta length of the entry at a pool offset.
+     * @param pos Offset of the entry header.
+     * @return Length of the entry's delta in bytes.
+     */
+    uint16_t entryLength(uint16_t pos) const {
+        uint16_t len;
+        memcpy(&len, pool + pos, sizeof(len));
+        return len;
+    }
+
+    /**
+     * @brief Removes the oldest delta from the pool.
+     */
+    void dropOldest() {
+        if (entries == 0) return;
+        uint16_t len = entryLength(0) + ENTRY_HEADER;
+        memmove(pool, pool + len, used - len);
+        used -= len;
+        entries--;
+        drop_count++;
+    }
+};
+
+#endif  // BIT_BASED_STATE_HISTORY_H
@@ -0,0 +1,121 @@
+/**
+ * @file bit_based_state_machine.cpp
+ * @brief Implementation of BBStateMachine.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_machine.h"
+#include "bit_based_state_detail.h"
+#include <avr/pgmspace.h>
+#include <Arduino.h>
+
+// Constructor: Validates the table shape against the target
+BBStateMachine::BBStateMachine(BBStateControl& target, const uint8_t* progmemTable, uint8_t states, uint8_t events,
+                               bbsc_index_t first, uint8_t queueSize)
+    : target(target), table(progmemTable), first(first), state_count(states), event_count(events),
+      current(-1), queue(nullptr), queue_mask(0), head(0), tail(0), queued(0),
+      entryHook(nullptr), exitHook(nullptr), hookContext(nullptr) {
+    bool valid = progmemTable && states > 0 && states <= MAX_STATES && events > 0 && events <= MAX_EVENTS &&
+                 (uint32_t)first + states <= target.def_size; // Machine states must exist in the target
+    if (valid) {
+        uint8_t size = 1;
+        while (size < queueSize && size < MAX_QUEUE) size <<= 1;
+        queue = new uint8_t[size]();
+        if (queue) {
+            queue_mask = (uint8_t)(size - 1);
+            return;
+        }
+    }
+    table = nullptr;
+    state_count = 0;
+    event_count = 0;
+}
+
+// Destructor: Frees allocated memory
+BBStateMachine::~BBStateMachine() {
+    delete[] queue;
+}
+
+// Sets the entry and exit hooks
+void BBStateMachine::setHooks(StateHook onEntry, StateHook onExit, void* context) {
+    entryHook = onEntry;
+    exitHook = onExit;
+    hookContext = context;
+}
+
+// Enters the initial state
+bool BBStateMachine::start(uint8_t initial) {
+    if (!table || initial >= state_count) return false;
+    current = initial;
+    target.setState(first + initial, true, true);
+    if (entryHook) entryHook(initial, hookContext);
+    return true;
+}
+
+// Appends an event to the queue
+bool BBStateMachine::post(uint8_t event) {
+    if (!queue || event >= event_count) return false;
+    if (atomicFetchAdd(&queued, (uint8_t)1) > queue_mask) { // Full: give the slot back
+        atomicFetchAdd(&queued, (uint8_t)0xFF);
+        return false;
+    }
+    uint8_t slot = atomicFetchAdd(&head, (uint8_t)1) & queue_mask; // 256 is a multiple of the ring size
+    queue[slot] = (uint8_t)(event + 1);
+    return true;
+}
+
+// Gets the number of queued events
+uint8_t BBStateMachine::pendingEvents() const {
+    uint8_t n = atomicLoad(&queued);
+    return n > queue_mask + 1 ? (uint8_t)(queue_mask + 1) : n; // A full post() may be giving its slot back
+}
+
+// Looks up one transition in flash
+uint8_t BBStateMachine::nextState(uint8_t state, uint8_t event) const {
+    if (!table || state >= state_count || event >= event_count) return STAY;
+    uint8_t next = pgm_read_byte(&table[(uint16_t)state * event_count + event]);
+    return next < state_count ? next : STAY; // Out-of-range entries are ignored
+}
+
+// Handles the queued events in one batch
+uint8_t BBStateMachine::tick() {
+    if (!queue || current < 0) return 0; // Events wait for start()
+    uint8_t available = pendingEvents(); // Later posts wait for the next tick
+    if (!available) return 0;
+    uint8_t taken = 0;
+    BBStateControl::BatchUpdate batch(target); // One write and one notification per tick
+    for (uint8_t n = 0; n < available; n++) {
+        uint8_t slot = tail & queue_mask;
+        uint8_t entry = queue[slot];
+        if (!entry) break; // Slot reserved by a post() still writing it
+        queue[slot] = 0;
+        tail++;
+        atomicFetchAdd(&queued, (uint8_t)0xFF); // Frees the slot
+        uint8_t next = nextState((uint8_t)current, (uint8_t)(entry - 1));
+        if (next == STAY) continue;
+        enter(next);
+        taken++;
+    }
+    return taken;
+}
+
+// Handles one event now
+bool BBStateMachine::dispatch(uint8_t event) {
+    if (current < 0) return false;
+    uint8_t next = nextState((uint8_t)current, event);
+    if (next == STAY) return false;
+    enter(next);
+    return true;
+}
+
+// Runs the exit hook, moves the one-hot state and runs the entry hook
+void BBStateMachine::enter(uint8_t next) {
+    if (exitHook) exitHook((uint8_t)current, hookContext);
+    if (target.inBatch()) target.setState(first + current, false, false); // commit() defers the exclusive clear
+    current = next;
+    target.setState(first + next, true, true);
+    if (entryHook) entryHook(next, hookContext);
+}
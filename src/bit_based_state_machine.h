@@ -0,0 +1,148 @@
+/**
+ * @file bit_based_state_machine.h
+ * @brief Table-driven state machine using a BBStateControl as its one-hot state holder.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_MACHINE_H
+#define BIT_BASED_STATE_MACHINE_H
+
+#include <stdint.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStateMachine
+ * @brief Runs transitions from a flash table and mirrors the current state into an object.
+ *
+ * The transition table is a states x events array of uint8_t in PROGMEM:
+ * entry [s][e] is the state entered when event e arrives in state s, or STAY
+ * to ignore the event. A transition is one flash read, whatever the size of
+ * the machine. post() appends events to a FIFO queue (interrupt- and
+ * multi-core-safe) and tick() handles the queued events in one batch, in
+ * posting order and each as many times as it was posted, so the target's
+ * observer is notified once per tick. Hooks always see the target with only
+ * the current state set among the machine's states. Events wait in the queue
+ * until start(). The machine occupies target states first to
+ * first + states - 1; define them as a group (defineGroup()) to share the
+ * object with other states.
+ */
+class BBStateMachine {
+public:
+    static const uint8_t STAY = 0xFF;        ///< Table entry: ignore the event.
+    static const uint8_t MAX_EVENTS = 254;   ///< Events per machine.
+    static const uint8_t MAX_STATES = 254;   ///< States per machine.
+    static const uint8_t MAX_QUEUE = 128;    ///< Largest event queue.
+
+    /**
+     * @brief Callback type for state entry and exit.
+     * @param state Machine state entered or left.
+     * @param context User pointer passed to setHooks().
+     */
+    typedef void (*StateHook)(uint8_t state, void* context);
+
+    /**
+     * @brief Initializes a machine on a transition table.
+     * @param target Object holding the current state (must outlive the machine).
+     * @param progmemTable states * events bytes in PROGMEM, row-major by state.
+     * @param states Number of machine states (1 to MAX_STATES).
+     * @param events Number of events (1 to MAX_EVENTS).
+     * @param first Target state of machine state 0.
+     * @param queueSize Events that can wait for tick(), rounded up to a power of two (1 to MAX_QUEUE).
+     */
+    BBStateMachine(BBStateControl& target, const uint8_t* progmemTable, uint8_t states, uint8_t events,
+                   bbsc_index_t first = 0, uint8_t queueSize = 8);
+
+    /**
+     * @brief Frees allocated memory.
+     */
+    ~BBStateMachine();
+
+    BBStateMachine(const BBStateMachine&) = delete;
+    BBStateMachine& operator=(const BBStateMachine&) = delete;
+
+    /**
+     * @brief Sets the entry and exit hooks.
+     * @param onEntry Called after a state is entered (nullptr for none).
+     * @param onExit Called before a state is left (nullptr for none).
+     * @param context User pointer passed to the hooks.
+     */
+    void setHooks(StateHook onEntry, StateHook onExit, void* context = nullptr);
+
+    /**
+     * @brief Enters the initial state (runs its entry hook).
+     * @param initial Machine state.
+     * @return False if the machine or the state is invalid.
+     */
+    bool start(uint8_t initial);
+
+    /**
+     * @brief Appends an event to the queue for the next tick() (safe from interrupts).
+     * @param event Event number (0 to events-1).
+     * @return False if the event is out of range or the queue is full (event lost).
+     */
+    bool post(uint8_t event);
+
+    /**
+     * @brief Handles the queued events in posting order.
+     *
+     * Events posted while tick() runs (from hooks or interrupts) wait for the
+     * next call. Does nothing before start(): the queue is kept.
+     *
+     * @return Number of transitions taken.
+     */
+    uint8_t tick();
+
+    /**
+     * @brief Handles one event immediately.
+     * @param event Event number (0 to events-1).
+     * @return True if a transition was taken.
+     */
+    bool dispatch(uint8_t event);
+
+    /**
+     * @brief Gets the current state.
+     * @return Machine state, or -1 before start().
+     */
+    int16_t state() const { return current; }
+
+    /**
+     * @brief Looks up a transition without taking it.
+     * @param state Machine state.
+     * @param event Event number.
+     * @return Next state, or STAY if ignored or out of range.
+     */
+    uint8_t nextState(uint8_t state, uint8_t event) const;
+
+    /**
+     * @brief Gets the number of queued events.
+     * @return Events waiting for tick().
+     */
+    uint8_t pendingEvents() const;
+
+private:
+    BBStateControl& target;   ///< Object holding the current state.
+    const uint8_t* table;     ///< Transition table in PROGMEM (nullptr if invalid).
+    bbsc_index_t first;       ///< Target state of machine state 0.
+    uint8_t state_count;      ///< Machine states.
+    uint8_t event_count;      ///< Events.
+    int16_t current;          ///< Current machine state (-1 before start()).
+    volatile uint8_t* queue;  ///< Event ring: event + 1 per slot, 0 if free or not yet written.
+    uint8_t queue_mask;       ///< Ring size - 1 (a power of two minus one).
+    volatile uint8_t head;    ///< Next slot to reserve (producers).
+    uint8_t tail;             ///< Next slot to read (tick() only).
+    volatile uint8_t queued;  ///< Reserved slots not yet read.
+    StateHook entryHook;      ///< Entry callback (nullptr if none).
+    StateHook exitHook;       ///< Exit callback (nullptr if none).
+    void* hookContext;        ///< User pointer passed to the hooks.
+
+    /**
+     * @brief Leaves the current state and enters another.
+     * @param next Machine state (validated).
+     */
+    void enter(uint8_t next);
+};
+
+#endif  // BIT_BASED_STATE_MACHINE_H
@@ -0,0 +1,169 @@
+/**
+ * @file bit_based_state_persist.cpp
+ * @brief Implementation of BBStatePersist.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_persist.h"
+#include "bit_based_state_detail.h"
+#include <Arduino.h>
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#endif
+
+// Feeds one byte into a CRC-8
+static inline uint8_t crcByte(uint8_t crc, uint8_t value) {
+    return BBStateControl::crc8(&value, 1, crc);
+}
+
+// Checks if sequence number a is newer than b (wrap-around safe)
+static inline bool seqNewer(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) > 0;
+}
+
+// Constructor: Stores the storage callbacks and ring layout
+BBStatePersist::BBStatePersist(ReadByte read, WriteByte write, uint32_t base, uint8_t slots, void* context)
+    : readByte(read), writeByte(write), context(context), base(base),
+      slots(slots < NO_SLOT ? slots : NO_SLOT - 1), located(0), newest(NO_SLOT), seq(0), written(0) {}
+
+// Reads the sequence number of a slot
+uint16_t BBStatePersist::readSeq(uint8_t slot, bbsc_index_t states) const {
+    uint32_t addr = slotAddress(slot, states);
+    return (uint16_t)(readByte(addr, context) | ((uint16_t)readByte(addr + 1, context) << 8));
+}
+
+// Computes the CRC of a slot as stored
+uint8_t BBStatePersist::slotCrc(uint8_t slot, bbsc_index_t states, uint16_t slotSeq) const {
+    uint8_t crc = 0;
+    uint32_t size = states;
+    for (uint8_t i = 0; i < 4; i++) {
+        crc = crcByte(crc, (uint8_t)(size >> (8 * i))); // Rejects slots laid out for another size
+    }
+    crc = crcByte(crc, (uint8_t)slotSeq);
+    crc = crcByte(crc, (uint8_t)(slotSeq >> 8));
+    uint32_t addr = slotAddress(slot, states) + HEADER;
+    size_t bytes = slotSize(states) - HEADER;
+    for (size_t i = 0; i < bytes; i++) {
+        crc = crcByte(crc, readByte(addr + i, context));
+    }
+    return crc;
+}
+
+// Finds the newest valid slot, checking one CRC per candidate
+void BBStatePersist::locate(bbsc_index_t states) {
+    located = states;
+    newest = NO_SLOT;
+    bool bounded = false;
+    uint16_t below = 0;
+    for (uint8_t attempt = 0; attempt < slots; attempt++) {
+        uint8_t best = NO_SLOT;
+        uint16_t bestSeq = 0;
+        for (uint8_t s = 0; s < slots; s++) {
+            uint16_t q = readSeq(s, states);
+            if (q == ERASED || (bounded && !seqNewer(below, q))) continue;
+            if (best == NO_SLOT || seqNewer(q, bestSeq)) {
+                best = s;
+                bestSeq = q;
+            }
+        }
+        if (best == NO_SLOT) return;
+        if (readByte(slotAddress(best, states) + 2, context) == slotCrc(best, states, bestSeq)) {
+            newest = best;
+            seq = bestSeq;
+            return;
+        }
+        bounded = true; // Torn write: try the next older slot
+        below = bestSeq;
+    }
+}
+
+// Checks if the current slot already holds the states
+bool BBStatePersist::matches(const BBStateControl& states) const {
+    if (newest == NO_SLOT) return false;
+    uint32_t addr = slotAddress(newest, states.def_size) + HEADER;
+    for (bbsc_index_t i = 0; i < states.stateBytes(); i++) {
+        if (readByte(addr + i, context) != states.getByte(i)) return false;
+    }
+    return true;
+}
+
+// Writes a byte only if it differs from storage
+void BBStatePersist::update(uint32_t address, uint8_t value) {
+    if (readByte(address, context) == value) return;
+    writeByte(address, value, context);
+    written++;
+}
+
+// Loads the newest valid slot
+bool BBStatePersist::load(BBStateControl& states) {
+    if (!readByte || !states.array || slots == 0) return false;
+    locate(states.def_size);
+    if (newest == NO_SLOT) return false;
+
+    uint32_t addr = slotAddress(newest, states.def_size) + HEADER;
+    bbsc_index_t count = states.stateBytes();
+    for (bbsc_index_t i = 0; i < states.word_size; i++) {
+        bbsc_word_t w = 0;
+        for (uint8_t b = 0; b < WORD_BYTES; b++) {
+            bbsc_index_t index = i * WORD_BYTES + b;
+            if (index < count) w |= (bbsc_word_t)readByte(addr + index, context) << (b * 8);
+        }
+        if (i == states.word_size - 1) w &= states.lastWordMask(); // Unused bits stay clear
+        states.storeWord(i, w);
+    }
+    states.invalidateTrueIndex();
+    states.endChange();
+    return true;
+}
+
+// Stores the states in the next slot
+bool BBStatePersist::persist(const BBStateControl& states) {
+    if (!readByte || !writeByte || !states.array || slots == 0) return false;
+    written = 0;
+    if (located != states.def_size) locate(states.def_size);
+    if (matches(states)) return true; // Nothing changed since the last commit
+
+    uint8_t target = newest == NO_SLOT ? 0 : (uint8_t)((newest + 1) % slots);
+    uint16_t nextSeq = newest == NO_SLOT ? 0 : (uint16_t)(seq + 1);
+    if (nextSeq == ERASED) nextSeq = 0;
+
+    // Payload first, header last: an interrupted write fails the CRC
+    uint32_t addr = slotAddress(target, states.def_size);
+    for (bbsc_index_t i = 0; i < states.stateBytes(); i++) {
+        update(addr + HEADER + i, states.getByte(i));
+    }
+    update(addr, (uint8_t)nextSeq);
+    update(addr + 1, (uint8_t)(nextSeq >> 8));
+    update(addr + 2, slotCrc(target, states.def_size, nextSeq));
+
+    newest = target;
+    seq = nextSeq;
+    return true;
+}
+
+// Marks every slot as empty
+void BBStatePersist::erase(bbsc_index_t states) {
+    if (!readByte || !writeByte) return;
+    for (uint8_t s = 0; s < slots; s++) {
+        uint32_t addr = slotAddress(s, states);
+        update(addr, (uint8_t)ERASED);
+        update(addr + 1, (uint8_t)(ERASED >> 8));
+    }
+    located = states;
+    newest = NO_SLOT;
+}
+
+#if defined(__AVR__)
+// Reads one byte of the AVR EEPROM
+uint8_t BBStatePersist::eepromRead(uint32_t address, void*) {
+    return eeprom_read_byte((const uint8_t*)(uintptr_t)address);
+}
+
+// Writes one byte of the AVR EEPROM
+void BBStatePersist::eepromWrite(uint32_t address, uint8_t value, void*) {
+    eeprom_write_byte((uint8_t*)(uintptr_t)address, value);
+}
+#endif
@@ -0,0 +1,197 @@
+/**
+ * @file bit_based_state_persist.h
+ * @brief Wear-leveled EEPROM/flash persistence for BBStateControl.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_PERSIST_H
+#define BIT_BASED_STATE_PERSIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStatePersist
+ * @brief Stores the raw bitfield of a BBStateControl in a ring of storage slots.
+ *
+ * Each slot holds a 16-bit sequence number, a CRC-8 and the states packed one
+ * bit per state. persist() writes the next slot of the ring, so writes are
+ * spread over every slot, and only bytes that differ from the slot's previous
+ * content are written. The header is written last: a write interrupted by a
+ * power loss leaves a slot with a bad CRC and load() falls back to the
+ * previous one. load() finds the newest slot by reading the headers only and
+ * verifies the CRC of that slot alone.
+ *
+ * Storage is accessed through two callbacks, so the same code works with the
+ * AVR EEPROM (see eepromRead() and eepromWrite()), EEPROM emulation libraries
+ * or an external chip.
+ */
+class BBStatePersist {
+public:
+    /**
+     * @brief Reads one byte of storage.
+     * @param address Storage address.
+     * @param context User pointer given to the constructor.
+     * @return Byte at the address.
+     */
+    typedef uint8_t (*ReadByte)(uint32_t address, void* context);
+
+    /**
+     * @brief Writes one byte of storage.
+     * @param address Storage address.
+     * @param value Byte to write.
+     * @param context User pointer given to the constructor.
+     */
+    typedef void (*WriteByte)(uint32_t address, uint8_t value, void* context);
+
+    /**
+     * @brief Initializes a slot ring. Nothing is read until load() or persist().
+     * @param read Byte read callback.
+     * @param write Byte write callback.
+     * @param base Storage address of the first slot.
+     * @param slots Number of slots in the ring (1 or more).
+     * @param context User pointer passed to both callbacks.
+     */
+    BBStatePersist(ReadByte read, WriteByte write, uint32_t base, uint8_t slots, void* context = nullptr);
+
+    /**
+     * @brief Gets the storage size of one slot.
+     * @param states Number of states stored.
+     * @return Header plus one bit per state, in bytes.
+     */
+    static size_t slotSize(bbsc_index_t states) { return HEADER + ((size_t)states + 7) / 8; }
+
+    /**
+     * @brief Gets the storage size of a whole ring.
+     * @param states Number of states stored.
+     * @param slots Number of slots.
+     * @return Bytes used from the base address.
+     */
+    static size_t ringSize(bbsc_index_t states, uint8_t slots) { return slotSize(states) * slots; }
+
+    /**
+     * @brief Loads the newest valid slot into an object.
+     *
+     * Slots are ordered by their headers; if the newest one fails its CRC, the
+     * next older one is tried.
+     *
+     * @param states Object to restore (its size selects the slot layout).
+     * @return True if a valid slot was loaded, false if the ring holds none.
+     */
+    bool load(BBStateControl& states);
+
+    /**
+     * @brief Stores the states in the next slot of the ring.
+     *
+     * Does nothing if the newest slot already holds the same states, so calling
+     * it periodically costs no writes while nothing changes.
+     *
+     * @param states Object to store.
+     * @return True if the states are in storage, false on invalid arguments.
+     */
+    bool persist(const BBStateControl& states);
+
+    /**
+     * @brief Marks every slot as empty (writes only the sequence numbers).
+     * @param states Number of states the ring was laid out for.
+     */
+    void erase(bbsc_index_t states);
+
+    /**
+     * @brief Gets the slot written or loaded last.
+     * @return Slot number, or -1 if none.
+     */
+    int16_t currentSlot() const { return newest == NO_SLOT ? -1 : newest; }
+
+    /**
+     * @brief Gets the sequence number of the current slot.
+     * @return Sequence number (meaningful if currentSlot() is not -1).
+     */
+    uint16_t sequence() const { return seq; }
+
+    /**
+     * @brief Gets the number of bytes written by the last persist().
+     * @return Bytes written, 0 if nothing had changed.
+     */
+    size_t lastWriteBytes() const { return written; }
+
+#if defined(__AVR__)
+    /**
+     * @brief ReadByte callback for the internal AVR EEPROM.
+     */
+    static uint8_t eepromRead(uint32_t address, void* context);
+
+    /**
+     * @brief WriteByte callback for the internal AVR EEPROM.
+     */
+    static void eepromWrite(uint32_t address, uint8_t value, void* context);
+#endif
+
+private:
+    static const uint8_t HEADER = 3;           ///< Sequence number (2 bytes) and CRC-8.
+    static const uint16_t ERASED = 0xFFFF;     ///< Sequence number of an empty slot.
+    static const uint8_t NO_SLOT = 0xFF;       ///< newest value for "none".
+
+    ReadByte readByte;     ///< Byte read callback.
+    WriteByte writeByte;   ///< Byte write callback.
+    void* context;         ///< User pointer passed to the callbacks.
+    uint32_t base;         ///< Address of slot 0.
+    uint8_t slots;         ///< Number of slots in the ring.
+    bbsc_index_t located;  ///< State count the ring was scanned for (0 if not scanned).
+    uint8_t newest;        ///< Newest valid slot (NO_SLOT if none).
+    uint16_t seq;          ///< Sequence number of the newest slot.
+    size_t written;        ///< Bytes written by the last persist().
+
+    /**
+     * @brief Gets the storage address of a slot.
+     * @param slot Slot number.
+     * @param states Number of states stored.
+     * @return Address of the slot header.
+     */
+    uint32_t slotAddress(uint8_t slot, bbsc_index_t states) const {
+        return base + (uint32_t)slot * slotSize(states);
+    }
+
+    /**
+     * @brief Reads the sequence number of a slot.
+     * @param slot Slot number.
+     * @param states Number of states stored.
+     * @return Sequence number, ERASED if the slot is empty.
+     */
+    uint16_t readSeq(uint8_t slot, bbsc_index_t states) const;
+
+    /**
+     * @brief Computes the CRC of a slot as stored.
+     * @param slot Slot number.
+     * @param states Number of states stored.
+     * @param slotSeq Sequence number of the slot.
+     * @return CRC over the state count, sequence number and payload.
+     */
+    uint8_t slotCrc(uint8_t slot, bbsc_index_t states, uint16_t slotSeq) const;
+
+    /**
+     * @brief Finds the newest slot whose CRC is valid, from headers first.
+     * @param states Number of states stored.
+     */
+    void locate(bbsc_index_t states);
+
+    /**
+     * @brief Checks if the current slot already holds an object's states.
+     * @param states Object to compare.
+     * @return True if every payload byte matches.
+     */
+    bool matches(const BBStateControl& states) const;
+
+    /**
+     * @brief Writes a byte only if storage holds a different value.
+     * @param address Storage address.
+     * @param value Byte to write.
+     */
+    void update(uint32_t address, uint8_t value);
+};
+
+#endif  // BIT_BASED_STATE_PERSIST_H
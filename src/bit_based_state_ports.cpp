@@ -0,0 +1,172 @@
+/**
+ * @file bit_based_state_ports.cpp
+ * @brief Implementation of BBStatePorts.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_ports.h"
+#include <Arduino.h>
+#if defined(__AVR__)
+#include <util/atomic.h>
+#endif
+
+// Bits in a port register
+static const uint8_t PORT_BITS = sizeof(bbsc_port_t) * 8;
+
+// Largest table whose mapping numbers fit an int8_t
+static const uint8_t MAX_MAPS = 127;
+
+// Mask of the n lowest bits of a word (n from 1 to BBSC_WORD_BITS)
+static inline bbsc_word_t lowWordBits(uint8_t n) {
+    return n >= BBSC_WORD_BITS ? (bbsc_word_t)~(bbsc_word_t)0 : (bbsc_word_t)(((bbsc_word_t)1 << n) - 1);
+}
+
+// Mask of the n lowest bits of a port register (n from 1 to PORT_BITS)
+static inline bbsc_port_t lowPortBits(uint8_t n) {
+    return n >= PORT_BITS ? (bbsc_port_t)~(bbsc_port_t)0 : (bbsc_port_t)(((bbsc_port_t)1 << n) - 1);
+}
+
+// Replaces the masked pins of a register (other pins may be changed by interrupts)
+static inline void writePins(volatile bbsc_port_t* reg, bbsc_port_t mask, bbsc_port_t value) {
+#if defined(__AVR__)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *reg = (bbsc_port_t)((*reg & ~mask) | value);
+    }
+#else
+    *reg = (bbsc_port_t)((*reg & ~mask) | value); // Use set/clear registers where interrupts share the port
+#endif
+}
+
+// Constructor: Allocates the mapping table
+BBStatePorts::BBStatePorts(BBStateControl& target, uint8_t capacity)
+    : target(target), maps(nullptr), cap(capacity > MAX_MAPS ? MAX_MAPS : capacity), map_count(0) {
+    if (cap == 0) return;
+    maps = new PortMap[cap];
+    if (!maps) cap = 0;
+}
+
+// Destructor: Frees allocated memory
+BBStatePorts::~BBStatePorts() {
+    delete[] maps;
+}
+
+// Maps states to a read-modify-write output register
+int8_t BBStatePorts::mapOutput(bbsc_index_t first, uint8_t count, volatile bbsc_port_t* port, uint8_t pin) {
+    return addMap(first, count, port, nullptr, pin, MAP_RMW);
+}
+
+// Maps states to set/clear output registers
+int8_t BBStatePorts::mapOutput(bbsc_index_t first, uint8_t count, volatile bbsc_port_t* setReg,
+                               volatile bbsc_port_t* clearReg, uint8_t pin) {
+    if (!clearReg) return -1;
+    return addMap(first, count, setReg, clearReg, pin, MAP_SET_CLEAR);
+}
+
+// Maps an input register to states
+int8_t BBStatePorts::mapInput(bbsc_index_t first, uint8_t count, const volatile bbsc_port_t* reg, uint8_t pin,
+                              bool activeLow) {
+    return addMap(first, count, const_cast<volatile bbsc_port_t*>(reg), nullptr, pin,
+                  activeLow ? MAP_INPUT_LOW : MAP_INPUT);
+}
+
+// Validates and stores a mapping with its precomputed pin mask
+int8_t BBStatePorts::addMap(bbsc_index_t first, uint8_t count, volatile bbsc_port_t* reg,
+                            volatile bbsc_port_t* clear, uint8_t pin, uint8_t kind) {
+    if (!reg || map_count >= cap || count == 0) return -1;
+    if (pin >= PORT_BITS || count > PORT_BITS - pin) return -1; // Pins must fit the register
+    if ((uint32_t)first + count > target.def_size) return -1; // States must exist
+    PortMap& m = maps[map_count];
+    m.reg = reg;
+    m.clear = clear;
+    m.mask = (bbsc_port_t)(lowPortBits(count) << pin);
+    m.last = 0;
+    m.first = first;
+    m.count = count;
+    m.pin = pin;
+    m.kind = kind;
+    m.written = false;
+    return (int8_t)map_count++;
+}
+
+// Writes the output registers whose states changed
+uint8_t BBStatePorts::commit(bool force) {
+    uint8_t written = 0;
+    for (uint8_t i = 0; i < map_count; i++) {
+        PortMap& m = maps[i];
+        if (m.kind >= MAP_INPUT) continue;
+        bbsc_port_t value = (bbsc_port_t)(readStates(m.first, m.count) << m.pin);
+        bool full = force || !m.written;
+        if (!full && value == m.last) continue; // Pins already match
+        if (m.kind == MAP_SET_CLEAR) {
+            bbsc_port_t changed = full ? m.mask : (bbsc_port_t)(value ^ m.last);
+            bbsc_port_t set = (bbsc_port_t)(value & changed);
+            bbsc_port_t clear = (bbsc_port_t)(~value & changed);
+            if (set) *m.reg = set;
+            if (clear) *m.clear = clear;
+        } else {
+            writePins(m.reg, m.mask, value);
+        }
+        m.last = value;
+        m.written = true;
+        written++;
+    }
+    return written;
+}
+
+// Reads every input register into the bitfield
+bool BBStatePorts::sample() {
+    bool changed = false;
+    for (uint8_t i = 0; i < map_count; i++) {
+        const PortMap& m = maps[i];
+        if (m.kind < MAP_INPUT) continue;
+        bbsc_port_t pins = *m.reg;
+        if (m.kind == MAP_INPUT_LOW) pins = (bbsc_port_t)~pins;
+        if (writeStates(m.first, m.count, (bbsc_port_t)((pins & m.mask) >> m.pin))) changed = true;
+    }
+    if (!changed) return false;
+    target.invalidateTrueIndex();
+    target.endChange();
+    return true;
+}
+
+// Reads consecutive states, one word at a time
+bbsc_port_t BBStatePorts::readStates(bbsc_index_t first, uint8_t count) const {
+    bbsc_port_t value = 0;
+    uint8_t done = 0;
+    while (done < count) {
+        uint32_t index = (uint32_t)first + done;
+        uint8_t offset = index & BBSC_WORD_MASK;
+        uint8_t take = BBSC_WORD_BITS - offset;
+        if (take > count - done) take = count - done;
+        bbsc_word_t bits = (bbsc_word_t)((target.array[index >> BBSC_WORD_SHIFT] >> offset) & lowWordBits(take));
+        value |= (bbsc_port_t)((bbsc_port_t)bits << done);
+        done += take;
+    }
+    return value;
+}
+
+// Writes consecutive states, one word at a time
+bool BBStatePorts::writeStates(bbsc_index_t first, uint8_t count, bbsc_port_t value) {
+    bool changed = false;
+    uint8_t done = 0;
+    while (done < count) {
+        uint32_t index = (uint32_t)first + done;
+        bbsc_index_t word = index >> BBSC_WORD_SHIFT;
+        uint8_t offset = index & BBSC_WORD_MASK;
+        uint8_t take = BBSC_WORD_BITS - offset;
+        if (take > count - done) take = count - done;
+        bbsc_word_t mask = (bbsc_word_t)(lowWordBits(take) << offset);
+        bbsc_word_t bits = (bbsc_word_t)(((bbsc_word_t)(value >> done) << offset) & mask);
+        bbsc_word_t old = target.array[word];
+        bbsc_word_t next = (bbsc_word_t)((old & ~mask) | bits);
+        if (next != old) {
+            target.storeWord(word, next);
+            changed = true;
+        }
+        done += take;
+    }
+    return changed;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file bit_based_state_ports.h
+ * @brief Bulk mirroring of BBStateControl states to and from GPIO port registers.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_PORTS_H
+#define BIT_BASED_STATE_PORTS_H
+
+#include <stdint.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @brief Width of a GPIO port register: 8 bits on AVR (PORTx/PINx), 32 bits elsewhere.
+ */
+#if defined(__AVR__)
+typedef uint8_t bbsc_port_t;
+#else
+typedef uint32_t bbsc_port_t;
+#endif
+
+/**
+ * @class BBStatePorts
+ * @brief Maps ranges of states onto the pins of GPIO port registers.
+ *
+ * Each mapping ties `count` consecutive states to `count` consecutive pins of
+ * one register, with the pin mask precomputed. commit() writes each output
+ * register once, and only when its states changed since the last write;
+ * sample() reads each input register once and stores the pins into the
+ * bitfield in bulk. This replaces one digitalWrite()/digitalRead() per pin.
+ * Pin directions are left to the sketch (pinMode() or DDRx).
+ */
+class BBStatePorts {
+public:
+    /**
+     * @brief Initializes an empty mapping table for an object.
+     * @param target Object whose states are mirrored (must outlive the mapping).
+     * @param capacity Maximum number of mappings.
+     */
+    BBStatePorts(BBStateControl& target, uint8_t capacity);
+
+    /**
+     * @brief Frees allocated memory.
+     */
+    ~BBStatePorts();
+
+    BBStatePorts(const BBStatePorts&) = delete;
+    BBStatePorts& operator=(const BBStatePorts&) = delete;
+
+    /**
+     * @brief Maps states to pins of an output register written read-modify-write (e.g. PORTB).
+     * @param first First state of the range.
+     * @param count Number of states and pins (1 to register width - pin).
+     * @param port Output register.
+     * @param pin Register bit of state first.
+     * @return Mapping number, or -1 if invalid or the table is full.
+     */
+    int8_t mapOutput(bbsc_index_t first, uint8_t count, volatile bbsc_port_t* port, uint8_t pin);
+
+    /**
+     * @brief Maps states to pins driven through set and clear registers (e.g. ESP32 GPIO_OUT_W1TS/W1TC).
+     * @param first First state of the range.
+     * @param count Number of states and pins (1 to register width - pin).
+     * @param setReg Register setting the pins written as 1.
+     * @param clearReg Register clearing the pins written as 1.
+     * @param pin Register bit of state first.
+     * @return Mapping number, or -1 if invalid or the table is full.
+     */
+    int8_t mapOutput(bbsc_index_t first, uint8_t count, volatile bbsc_port_t* setReg,
+                     volatile bbsc_port_t* clearReg, uint8_t pin);
+
+    /**
+     * @brief Maps pins of an input register to states (e.g. PIND).
+     * @param first First state of the range.
+     * @param count Number of states and pins (1 to register width - pin).
+     * @param reg Input register.
+     * @param pin Register bit of state first.
+     * @param activeLow True to store a low pin as a true state (pull-up buttons).
+     * @return Mapping number, or -1 if invalid or the table is full.
+     */
+    int8_t mapInput(bbsc_index_t first, uint8_t count, const volatile bbsc_port_t* reg, uint8_t pin,
+                    bool activeLow = false);
+
+    /**
+     * @brief Removes every mapping.
+     */
+    void clearMappings() { map_count = 0; }
+
+    /**
+     * @brief Gets the number of mappings.
+     * @return Mappings defined.
+     */
+    uint8_t mappingCount() const { return map_count; }
+
+    /**
+     * @brief Writes the output registers whose states changed since the last commit.
+     * @param force True to write every output register.
+     * @return Number of mappings written.
+     */
+    uint8_t commit(bool force = false);
+
+    /**
+     * @brief Reads every input register into the bitfield.
+     * @return True if any state changed.
+     */
+    bool sample();
+
+private:
+    static const uint8_t MAP_RMW = 0;        ///< Output written read-modify-write.
+    static const uint8_t MAP_SET_CLEAR = 1;  ///< Output written through set/clear registers.
+    static const uint8_t MAP_INPUT = 2;      ///< Input register.
+    static const uint8_t MAP_INPUT_LOW = 3;  ///< Input register, active low.
+
+    /**
+     * @struct PortMap
+     * @brief One range of states mapped to one register.
+     */
+    struct PortMap {
+        volatile bbsc_port_t* reg;    ///< Output, set or input register.
+        volatile bbsc_port_t* clear;  ///< Clear register (MAP_SET_CLEAR only).
+        bbsc_port_t mask;             ///< Pins of the range in the register.
+        bbsc_port_t last;             ///< Pins last written (outputs).
+        bbsc_index_t first;           ///< First state of the range.
+        uint8_t count;                ///< Number of states.
+        uint8_t pin;                  ///< Register bit of the first state.
+        uint8_t kind;                 ///< MAP_RMW, MAP_SET_CLEAR, MAP_INPUT or MAP_INPUT_LOW.
+        bool written;                 ///< False until the first commit of an output.
+    };
+
+    BBStateControl& target;  ///< Object whose states are mirrored.
+    PortMap* maps;           ///< Mapping table.
+    uint8_t cap;             ///< Table capacity.
+    uint8_t map_count;       ///< Mappings in use.
+
+    /**
+     * @brief Validates and stores a mapping.
+     * @return Mapping number, or -1.
+     */
+    int8_t addMap(bbsc_index_t first, uint8_t count, volatile bbsc_port_t* reg,
+                  volatile bbsc_port_t* clear, uint8_t pin, uint8_t kind);
+
+    /**
+     * @brief Reads consecutive states as pin bits.
+     * @param first First state (validated).
+     * @param count Number of states (at most the register width).
+     * @return State first in bit 0.
+     */
+    bbsc_port_t readStates(bbsc_index_t first, uint8_t count) const;
+
+    /**
+     * @brief Writes consecutive states from pin bits.
+     * @param first First state (validated).
+     * @param count Number of states (at most the register width).
+     * @param value State first in bit 0.
+     * @return True if any state changed.
+     */
+    bool writeStates(bbsc_index_t first, uint8_t count, bbsc_port_t value);
+};
+
+#endif  // BIT_BASED_STATE_PORTS_H
@@ -0,0 +1,112 @@
+/**
+ * @file bit_based_state_preset.h
+ * @brief Compile-time state masks stored in flash, for BBStateControl::loadPreset().
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_PRESET_H
+#define BIT_BASED_STATE_PRESET_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @brief Flash-resident mask of an object with `size` states and the listed states set.
+ *
+ * BBSC_MASK(16, 1, 4, 9) evaluates to a `const uint8_t*` into PROGMEM holding
+ * the size as sizeof(bbsc_index_t) little-endian bytes, then (16 + 7) / 8
+ * bytes with state i in bit i % 8 of byte i / 8: the layout read by
+ * loadPreset() and matchesPreset(), which reject a mask of another size. The
+ * bytes are computed by the compiler and identical masks share one array.
+ * Indices must be below `size`.
+ */
+#define BBSC_MASK(...) (BBStateMask<__VA_ARGS__>::bytes)
+
+/**
+ * @brief Sequence of byte positions 0 to N-1 (built in log2(N) steps).
+ * @tparam B Byte positions.
+ */
+template <uint32_t... B>
+struct BBStateMaskBytes {};
+
+template <class A, class B>
+struct BBStateMaskConcat;
+
+template <uint32_t... A, uint32_t... B>
+struct BBStateMaskConcat<BBStateMaskBytes<A...>, BBStateMaskBytes<B...>> {
+    typedef BBStateMaskBytes<A..., (sizeof...(A) + B)...> type;
+};
+
+template <uint32_t N>
+struct BBStateMaskSequence
+    : BBStateMaskConcat<typename BBStateMaskSequence<N / 2>::type, typename BBStateMaskSequence<N - N / 2>::type> {};
+
+template <>
+struct BBStateMaskSequence<0> {
+    typedef BBStateMaskBytes<> type;
+};
+
+template <>
+struct BBStateMaskSequence<1> {
+    typedef BBStateMaskBytes<0> type;
+};
+
+// Bits of one mask byte (end of the index list)
+constexpr uint8_t bbscMaskByte(uint32_t) {
+    return 0;
+}
+
+// Bits of one mask byte set by the listed indices
+template <typename... T>
+constexpr uint8_t bbscMaskByte(uint32_t byte, uint32_t first, T... rest) {
+    return (uint8_t)(((first >> 3) == byte ? 1u << (first & 7) : 0u) | bbscMaskByte(byte, rest...));
+}
+
+// Checks that every listed index is below size (end of the index list)
+constexpr bool bbscMaskInRange(uint32_t) {
+    return true;
+}
+
+// Checks that every listed index is below size
+template <typename... T>
+constexpr bool bbscMaskInRange(uint32_t size, uint32_t first, T... rest) {
+    return first < size && bbscMaskInRange(size, rest...);
+}
+
+template <class Header, class Bytes, bbsc_index_t Size, bbsc_index_t... Indices>
+struct BBStateMaskData;
+
+template <uint32_t... H, uint32_t... B, bbsc_index_t Size, bbsc_index_t... Indices>
+struct BBStateMaskData<BBStateMaskBytes<H...>, BBStateMaskBytes<B...>, Size, Indices...> {
+    static const uint8_t bytes[sizeof...(H) + sizeof...(B)];  ///< Size, then mask bytes (PROGMEM).
+};
+
+template <uint32_t... H, uint32_t... B, bbsc_index_t Size, bbsc_index_t... Indices>
+const uint8_t BBStateMaskData<BBStateMaskBytes<H...>, BBStateMaskBytes<B...>, Size, Indices...>
+    ::bytes[sizeof...(H) + sizeof...(B)] PROGMEM = {
+    (uint8_t)((uint32_t)Size >> (8 * H))..., bbscMaskByte(B, Indices...)...
+};
+
+/**
+ * @class BBStateMask
+ * @brief Compile-time mask behind BBSC_MASK().
+ * @tparam Size Number of states of the objects the mask is loaded into.
+ * @tparam Indices States set in the mask.
+ */
+template <bbsc_index_t Size, bbsc_index_t... Indices>
+struct BBStateMask : BBStateMaskData<typename BBStateMaskSequence<sizeof(bbsc_index_t)>::type,
+                                     typename BBStateMaskSequence<((Size + 7u) >> 3)>::type, Size, Indices...> {
+    static_assert(Size > 0 && Size <= BBSC_MAX_STATES, "BBSC_MASK supports 1 to BBSC_MAX_STATES states");
+    static_assert(bbscMaskInRange(Size, Indices...), "BBSC_MASK index must be below the size");
+
+    static constexpr bbsc_index_t BYTE_SIZE = (Size + 7u) >> 3;  ///< Mask bytes after the size.
+};
+
+template <bbsc_index_t Size, bbsc_index_t... Indices>
+constexpr bbsc_index_t BBStateMask<Size, Indices...>::BYTE_SIZE;
+
+#endif  // BIT_BASED_STATE_PRESET_H
@@ -0,0 +1,162 @@
+/**
+ * @file bit_based_state_recorder.cpp
+ * @brief Implementation of BBStateRecorder.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_recorder.h"
+#include <Arduino.h>
+#include <string.h>
+
+// Bytes taken by a varint
+static inline uint8_t varintSize(uint32_t value) {
+    uint8_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+// Appends a varint if it fits before end
+static inline bool putVarint(uint8_t* out, size_t& pos, size_t end, uint32_t value) {
+    if (pos + varintSize(value) > end) return false;
+    while (value >= 0x80) {
+        out[pos++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[pos++] = (uint8_t)value;
+    return true;
+}
+
+// Constructor: Allocates two blocks and the previous frame
+BBStateRecorder::BBStateRecorder(const BBStateControl& source, size_t blockSize, uint16_t keyframeInterval,
+                                 BlockWriter writer, void* context)
+    : source(source), writer(writer), context(context), blocks(nullptr), previous(nullptr),
+      block_size(0), used(0), lastTime(0), frame_count(0), drop_count(0),
+      keyInterval(keyframeInterval), sinceKey(0), active(0), needKey(true) {
+    full[0] = false;
+    full[1] = false;
+    if (!writer || !source.data() || blockSize < keyframeSize()) return; // A block must hold a keyframe
+    blocks = new uint8_t[2 * blockSize];
+    previous = new uint8_t[source.byteSize()];
+    if (!blocks || !previous) {
+        delete[] blocks;
+        delete[] previous;
+        blocks = nullptr;
+        previous = nullptr;
+        return;
+    }
+    block_size = blockSize;
+}
+
+// Destructor: Frees allocated memory
+BBStateRecorder::~BBStateRecorder() {
+    delete[] blocks;
+    delete[] previous;
+}
+
+// Gets the size of a keyframe
+size_t BBStateRecorder::keyframeSize() const {
+    size_t bytes = source.byteSize();
+    return 1 + 4 + varintSize((uint32_t)bytes) + bytes;
+}
+
+// Appends a frame with the current states
+bool BBStateRecorder::record(uint32_t now) {
+    if (!blocks) return false;
+    if (full[active]) { // Both blocks wait for flush()
+        drop_count++;
+        return false;
+    }
+    bool key = needKey || (keyInterval > 0 && sinceKey >= keyInterval);
+    if (!(key ? putKey(now) : putDelta(now))) {
+        if (!nextBlock()) {
+            drop_count++;
+            return false;
+        }
+        putKey(now); // An empty block always holds a keyframe
+    }
+    lastTime = now;
+    frame_count++;
+    return true;
+}
+
+// Writes the full blocks, oldest first
+uint8_t BBStateRecorder::flush(bool partial) {
+    if (!blocks) return 0;
+    if (partial && used > 0 && !full[active]) nextBlock();
+    uint8_t written = 0;
+    uint8_t first = full[active] ? active : (uint8_t)(active ^ 1); // Sitting on a full block: it is the older one
+    for (uint8_t k = 0; k < 2; k++) {
+        uint8_t b = (uint8_t)(first ^ k);
+        if (!full[b]) continue;
+        if (!writer(blocks + b * block_size, block_size, context)) break; // Retried on the next flush()
+        full[b] = false;
+        written++;
+    }
+    return written;
+}
+
+// Pads and queues the active block, then switches to the other one
+bool BBStateRecorder::nextBlock() {
+    memset(blocks + active * block_size + used, FRAME_PAD, block_size - used);
+    full[active] = true;
+    active ^= 1;
+    used = 0;
+    needKey = true; // Every block decodes on its own
+    return !full[active];
+}
+
+// Encodes a keyframe
+bool BBStateRecorder::putKey(uint32_t now) {
+    const uint8_t* states = source.data();
+    size_t bytes = source.byteSize();
+    if (used + keyframeSize() > block_size) return false;
+    uint8_t* out = blocks + active * block_size;
+    size_t pos = used;
+    out[pos++] = FRAME_KEY;
+    for (uint8_t i = 0; i < 4; i++) {
+        out[pos++] = (uint8_t)(now >> (8 * i));
+    }
+    putVarint(out, pos, block_size, (uint32_t)bytes);
+    memcpy(out + pos, states, bytes);
+    memcpy(previous, states, bytes);
+    used = pos + bytes;
+    sinceKey = 0;
+    needKey = false;
+    return true;
+}
+
+// Encodes the bytes changed since the previous frame
+bool BBStateRecorder::putDelta(uint32_t now) {
+    const uint8_t* states = source.data();
+    size_t bytes = source.byteSize();
+    uint32_t changes = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        if (states[i] != previous[i]) changes++;
+    }
+    uint8_t* out = blocks + active * block_size;
+    size_t pos = used;
+    if (pos + 1 > block_size) return false;
+    out[pos++] = changes ? FRAME_DELTA : FRAME_SAME;
+    if (!putVarint(out, pos, block_size, now - lastTime)) return false;
+    if (changes) {
+        if (!putVarint(out, pos, block_size, changes)) return false;
+        size_t next = 0; // Byte following the previous change
+        for (size_t i = 0; i < bytes; i++) {
+            uint8_t diff = states[i] ^ previous[i];
+            if (!diff) continue;
+            if (!putVarint(out, pos, block_size, (uint32_t)(i - next)) || pos + 1 > block_size) return false;
+            out[pos++] = diff;
+            next = i + 1;
+        }
+        memcpy(previous, states, bytes);
+    }
+    used = pos;
+    sinceKey++;
+    return true;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file bit_based_state_recorder.h
+ * @brief Compact binary log of BBStateControl frames, written in fixed-size blocks.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_RECORDER_H
+#define BIT_BASED_STATE_RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStateRecorder
+ * @brief Appends timestamped state frames to two blocks and hands full blocks to a writer.
+ *
+ * record() stores a frame in the active block without any formatting: a
+ * keyframe (raw bitfield) at the start of every block and every
+ * keyframeInterval frames, otherwise the bytes that changed since the
+ * previous frame (a frame with no change takes two bytes). When the active
+ * block is full the recorder switches to the other one; flush() writes full
+ * blocks from the main loop, so slow SD or serial writes never delay
+ * recording. Every block is padded to blockSize() and starts with a
+ * keyframe, so each one decodes on its own (see extras/recorder).
+ *
+ * Frame layout (varints are 7 bits per byte, low group first):
+ *   FRAME_KEY:   tag, time (uint32 LE), byte count (varint), raw bytes
+ *   FRAME_DELTA: tag, time delta (varint), change count (varint),
+ *                then per change: byte gap (varint), XOR byte
+ *   FRAME_SAME:  tag, time delta (varint)
+ *   FRAME_PAD:   fills the end of a block
+ */
+class BBStateRecorder {
+public:
+    static const uint8_t FRAME_PAD = 0x00;    ///< Padding up to the end of a block.
+    static const uint8_t FRAME_KEY = 0x01;    ///< Full bitfield with absolute time.
+    static const uint8_t FRAME_DELTA = 0x02;  ///< Changed bytes with time delta.
+    static const uint8_t FRAME_SAME = 0x03;   ///< No change, time delta only.
+
+    /**
+     * @brief Writes one full block.
+     * @param block Block bytes.
+     * @param len Block size.
+     * @param context User pointer given to the constructor.
+     * @return True if written; false keeps the block for the next flush().
+     */
+    typedef bool (*BlockWriter)(const uint8_t* block, size_t len, void* context);
+
+    /**
+     * @brief Initializes a recorder with two blocks.
+     * @param source Object recorded (must outlive the recorder).
+     * @param blockSize Bytes per block (512 for SD sectors); must hold a keyframe.
+     * @param keyframeInterval Frames between keyframes inside a block (0 for block starts only).
+     * @param writer Callback writing full blocks.
+     * @param context User pointer passed to writer.
+     */
+    BBStateRecorder(const BBStateControl& source, size_t blockSize, uint16_t keyframeInterval,
+                    BlockWriter writer, void* context = nullptr);
+
+    /**
+     * @brief Frees allocated memory.
+     */
+    ~BBStateRecorder();
+
+    BBStateRecorder(const BBStateRecorder&) = delete;
+    BBStateRecorder& operator=(const BBStateRecorder&) = delete;
+
+    /**
+     * @brief Appends a frame with the current states.
+     * @param now Timestamp, for example millis().
+     * @return True if stored, false if both blocks are waiting for flush() (frame dropped).
+     */
+    bool record(uint32_t now);
+
+    /**
+     * @brief Writes the full blocks.
+     * @param partial True to also close and write the active block (before a shutdown).
+     * @return Number of blocks written.
+     */
+    uint8_t flush(bool partial = false);
+
+    /**
+     * @brief Gets the size of each block.
+     * @return Bytes per block (0 if allocation failed or blockSize was too small).
+     */
+    size_t blockSize() const { return block_size; }
+
+    /**
+     * @brief Gets the bytes used by a keyframe of the recorded object.
+     * @return Largest frame size.
+     */
+    size_t keyframeSize() const;
+
+    /**
+     * @brief Gets the number of frames stored.
+     * @return Frames since construction.
+     */
+    uint32_t frames() const { return frame_count; }
+
+    /**
+     * @brief Gets the number of frames dropped because no block was free.
+     * @return Dropped frames since construction.
+     */
+    uint32_t dropped() const { return drop_count; }
+
+private:
+    const BBStateControl& source;  ///< Object recorded.
+    BlockWriter writer;            ///< Block output callback.
+    void* context;                 ///< User pointer passed to writer.
+    uint8_t* blocks;               ///< Two blocks of block_size bytes.
+    uint8_t* previous;             ///< States of the previous frame.
+    size_t block_size;             ///< Bytes per block.
+    size_t used;                   ///< Bytes used in the active block.
+    uint32_t lastTime;             ///< Timestamp of the previous frame.
+    uint32_t frame_count;          ///< Frames stored.
+    uint32_t drop_count;           ///< Frames dropped.
+    uint16_t keyInterval;          ///< Frames between keyframes (0 for block starts only).
+    uint16_t sinceKey;             ///< Frames since the last keyframe.
+    uint8_t active;                ///< Block being filled (0 or 1).
+    bool full[2];                  ///< Blocks waiting for flush().
+    bool needKey;                  ///< Next frame must be a keyframe.
+
+    /**
+     * @brief Pads the active block, queues it and switches to the other one.
+     * @return False if the other block is still waiting for flush().
+     */
+    bool nextBlock();
+
+    /**
+     * @brief Encodes a delta frame into the active block if it fits.
+     * @param now Timestamp.
+     * @return True if written, false if the block lacks room.
+     */
+    bool putDelta(uint32_t now);
+
+    /**
+     * @brief Encodes a keyframe into the active block if it fits.
+     * @param now Timestamp.
+     * @return True if written, false if the block lacks room.
+     */
+    bool putKey(uint32_t now);
+};
+
+#endif  // BIT_BASED_STATE_RECORDER_H
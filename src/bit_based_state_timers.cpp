@@ -0,0 +1,156 @@
+/**
+ * @file bit_based_state_timers.cpp
+ * @brief Implementation of BBStateTimers.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#include "bit_based_state_timers.h"
+#include <Arduino.h>
+
+// Checks if deadline a comes before b (wrap-around safe)
+static inline bool earlier(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+// Constructor: Allocates the heap
+BBStateTimers::BBStateTimers(BBStateControl& target, uint8_t capacity)
+    : target(target), heap(nullptr), cap(capacity), count(0) {
+    if (cap == 0) return;
+    heap = new Timer[cap];
+    if (!heap) cap = 0;
+}
+
+// Destructor: Frees allocated memory
+BBStateTimers::~BBStateTimers() {
+    delete[] heap;
+}
+
+// Sets a state and arms its timer
+bool BBStateTimers::setFor(bbsc_index_t index, uint32_t duration, uint32_t now, bool exclusive) {
+    if (!expireAt(index, now + duration)) return false;
+    target.setState(index, true, exclusive);
+    if (exclusive) cancelOthers(index);
+    return true;
+}
+
+// Arms or restarts the timer of a state
+bool BBStateTimers::expireAt(bbsc_index_t index, uint32_t deadline) {
+    if (!target.isValidIndex(index)) return false;
+    int16_t pos = find(index);
+    if (pos >= 0) {
+        uint32_t old = heap[pos].deadline;
+        heap[pos].deadline = deadline;
+        if (earlier(deadline, old)) {
+            siftUp((uint8_t)pos);
+        } else {
+            siftDown((uint8_t)pos);
+        }
+        return true;
+    }
+    if (count >= cap) return false;
+    heap[count].deadline = deadline;
+    heap[count].index = index;
+    siftUp(count++);
+    return true;
+}
+
+// Stops the timer of a state
+bool BBStateTimers::cancel(bbsc_index_t index) {
+    int16_t pos = find(index);
+    if (pos < 0) return false;
+    removeAt((uint8_t)pos);
+    return true;
+}
+
+// Clears the states whose deadline has passed
+uint8_t BBStateTimers::tick(uint32_t now) {
+    if (count == 0 || earlier(now, heap[0].deadline)) return 0; // Nothing due
+    uint8_t expired = 0;
+    BBStateControl::BatchUpdate batch(target);
+    while (count > 0 && !earlier(now, heap[0].deadline)) {
+        target.setState(heap[0].index, false, false);
+        removeAt(0);
+        expired++;
+    }
+    return expired;
+}
+
+// Gets the time left before a state expires
+uint32_t BBStateTimers::remaining(bbsc_index_t index, uint32_t now) const {
+    int16_t pos = find(index);
+    if (pos < 0 || !earlier(now, heap[pos].deadline)) return 0;
+    return heap[pos].deadline - now;
+}
+
+// Gets the earliest deadline
+bool BBStateTimers::nextDeadline(uint32_t& deadline) const {
+    if (count == 0) return false;
+    deadline = heap[0].deadline;
+    return true;
+}
+
+// Cancels the timers of the states cleared by an exclusive set
+void BBStateTimers::cancelOthers(bbsc_index_t index) {
+    int8_t group = target.groupOf(index);
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        bbsc_index_t other = heap[i].index;
+        bool cleared = other != index && (group < 0 || target.groupOf(other) == group);
+        if (!cleared) heap[kept++] = heap[i];
+    }
+    if (kept == count) return;
+    count = kept;
+    for (uint8_t i = count / 2; i-- > 0;) { // Rebuild the heap from the kept entries
+        siftDown(i);
+    }
+}
+
+// Finds the heap slot of a state's timer
+int16_t BBStateTimers::find(bbsc_index_t index) const {
+    for (uint8_t i = 0; i < count; i++) {
+        if (heap[i].index == index) return i;
+    }
+    return -1;
+}
+
+// Moves an entry up to its place
+void BBStateTimers::siftUp(uint8_t pos) {
+    Timer t = heap[pos];
+    while (pos > 0) {
+        uint8_t parent = (uint8_t)((pos - 1) / 2);
+        if (!earlier(t.deadline, heap[parent].deadline)) break;
+        heap[pos] = heap[parent];
+        pos = parent;
+    }
+    heap[pos] = t;
+}
+
+// Moves an entry down to its place
+void BBStateTimers::siftDown(uint8_t pos) {
+    Timer t = heap[pos];
+    for (;;) {
+        uint16_t child = 2 * (uint16_t)pos + 1;
+        if (child >= count) break;
+        if (child + 1 < count && earlier(heap[child + 1].deadline, heap[child].deadline)) child++;
+        if (!earlier(heap[child].deadline, t.deadline)) break;
+        heap[pos] = heap[child];
+        pos = (uint8_t)child;
+    }
+    heap[pos] = t;
+}
+
+// Removes the entry at a heap position
+void BBStateTimers::removeAt(uint8_t pos) {
+    count--;
+    if (pos == count) return;
+    uint32_t old = heap[pos].deadline;
+    heap[pos] = heap[count]; // Last entry fills the gap
+    if (earlier(heap[pos].deadline, old)) {
+        siftUp(pos);
+    } else {
+        siftDown(pos);
+    }
+}
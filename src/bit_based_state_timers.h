@@ -0,0 +1,172 @@
+/**
+ * @file bit_based_state_timers.h
+ * @brief Expiry deadlines for BBStateControl states, kept in a min-heap.
+ * @author ATphonOS
+ * @version v1.2.0
+ * @date 2024
+ * @license MIT
+ */
+
+#ifndef BIT_BASED_STATE_TIMERS_H
+#define BIT_BASED_STATE_TIMERS_H
+
+#include <stdint.h>
+#include "bit_based_state_control.h"
+
+/**
+ * @class BBStateTimers
+ * @brief Clears states of a BBStateControl when their deadline passes.
+ *
+ * Deadlines are kept in a binary min-heap sized for the number of timers that
+ * can run at once, not for the number of states. tick() only looks at the
+ * heap top, so it costs O(1) when nothing is due and O(log n) per expired
+ * timer. Arming, restarting or cancelling a timer first finds it with a
+ * linear scan of the running timers (O(n), n being at most the capacity).
+ * Times are millis() values: comparisons are wrap-around safe as long
+ * as every deadline is less than about 24 days away.
+ */
+class BBStateTimers {
+public:
+    /**
+     * @brief Initializes the timers for an object.
+     * @param target Object whose states expire (must outlive the timers).
+     * @param capacity Maximum number of timers running at once.
+     */
+    BBStateTimers(BBStateControl& target, uint8_t capacity);
+
+    /**
+     * @brief Frees allocated memory.
+     */
+    ~BBStateTimers();
+
+    BBStateTimers(const BBStateTimers&) = delete;
+    BBStateTimers& operator=(const BBStateTimers&) = delete;
+
+    /**
+     * @brief Sets a state to true and clears it after a duration.
+     *
+     * Restarts the timer if the state already has one. An exclusive set also
+     * cancels the timers of the states it clears (every other state, or the
+     * other states of the index's group).
+     *
+     * @param index Index of the state.
+     * @param duration Time until expiry, in ms.
+     * @param now Current time (millis()).
+     * @param exclusive If true, clears all other states as setState() does.
+     * @return True if the timer was armed, false if the index is invalid or all timers are in use.
+     */
+    bool setFor(bbsc_index_t index, uint32_t duration, uint32_t now, bool exclusive = false);
+
+    /**
+     * @brief Schedules the expiry of a state without changing it.
+     * @param index Index of the state.
+     * @param deadline Time at which the state is cleared (millis()).
+     * @return True if the timer was armed, false if the index is invalid or all timers are in use.
+     */
+    bool expireAt(bbsc_index_t index, uint32_t deadline);
+
+    /**
+     * @brief Stops the timer of a state, leaving the state as it is.
+     * @param index Index of the state.
+     * @return True if the state had a timer.
+     */
+    bool cancel(bbsc_index_t index);
+
+    /**
+     * @brief Stops every timer.
+     */
+    void cancelAll() { count = 0; }
+
+    /**
+     * @brief Clears every state whose deadline has passed.
+     *
+     * All expired states are cleared in one batch, so an observer of the target
+     * is notified once.
+     *
+     * @param now Current time (millis()).
+     * @return Number of timers that expired.
+     */
+    uint8_t tick(uint32_t now);
+
+    /**
+     * @brief Checks if a state has a running timer.
+     * @param index Index of the state.
+     * @return True if a timer is running.
+     */
+    bool isPending(bbsc_index_t index) const { return find(index) >= 0; }
+
+    /**
+     * @brief Gets the time left before a state expires.
+     * @param index Index of the state.
+     * @param now Current time (millis()).
+     * @return Milliseconds left, 0 if due or if the state has no timer.
+     */
+    uint32_t remaining(bbsc_index_t index, uint32_t now) const;
+
+    /**
+     * @brief Gets the earliest deadline, for example to decide how long to sleep.
+     * @param deadline Set to the earliest deadline if a timer is running.
+     * @return True if a timer is running.
+     */
+    bool nextDeadline(uint32_t& deadline) const;
+
+    /**
+     * @brief Gets the number of running timers.
+     * @return Timers in use.
+     */
+    uint8_t active() const { return count; }
+
+    /**
+     * @brief Gets the maximum number of running timers.
+     * @return Heap capacity (0 if allocation failed).
+     */
+    uint8_t capacity() const { return cap; }
+
+private:
+    /**
+     * @struct Timer
+     * @brief Heap entry: a state and its deadline.
+     */
+    struct Timer {
+        uint32_t deadline;   ///< Time at which the state is cleared.
+        bbsc_index_t index;  ///< State to clear.
+    };
+
+    BBStateControl& target;  ///< Object whose states expire.
+    Timer* heap;             ///< Min-heap ordered by deadline.
+    uint8_t cap;             ///< Heap capacity.
+    uint8_t count;           ///< Timers in use.
+
+    /**
+     * @brief Finds the heap slot of a state's timer.
+     * @param index Index of the state.
+     * @return Heap position, or -1 if the state has no timer.
+     */
+    int16_t find(bbsc_index_t index) const;
+
+    /**
+     * @brief Moves an entry towards the root until the heap is ordered.
+     * @param pos Heap position.
+     */
+    void siftUp(uint8_t pos);
+
+    /**
+     * @brief Moves an entry towards the leaves until the heap is ordered.
+     * @param pos Heap position.
+     */
+    void siftDown(uint8_t pos);
+
+    /**
+     * @brief Removes the entry at a heap position.
+     * @param pos Heap position.
+     */
+    void removeAt(uint8_t pos);
+
+    /**
+     * @brief Cancels the timers of the states an exclusive set of index clears.
+     * @param index State set exclusively (its own timer is kept).
+     */
+    void cancelOthers(bbsc_index_t index);
+};
+
+#endif  // BIT_BASED_STATE_TIMERS_H